@@ -0,0 +1,85 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+// C interface to haval_core for callers that can't use the templates (C, FFI);
+// pass_cnt is 3, 4 or 5 and fpt_len is 128, 160, 192, 224 or 256; functions
+// returning int return 0 on success or an errno value otherwise
+
+#include "haval-export.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// streaming hash state
+typedef struct haval_state haval_state;
+
+// digest size in bytes, 0 if fpt_len is not supported
+HAVAL_EXPORT size_t haval_digest_size(unsigned int fpt_len);
+
+// hash a buffer, EINVAL if the variant is not supported
+HAVAL_EXPORT int haval_hash(unsigned int pass_cnt, unsigned int fpt_len, const void* data, size_t data_len, void* digest);
+
+// hash count independent messages and store their digests back to back, several at a time
+// using the best SIMD kernel; one call amortizes the call overhead over the whole batch
+HAVAL_EXPORT int haval_hash_batch(
+        unsigned int pass_cnt,
+        unsigned int fpt_len,
+        const void* const* data,
+        const size_t* data_len,
+        size_t count,
+        void* digests);
+
+// same as haval_hash_batch for messages stored back to back in a single buffer
+HAVAL_EXPORT int haval_hash_concat(
+        unsigned int pass_cnt,
+        unsigned int fpt_len,
+        const void* data,
+        const size_t* data_len,
+        size_t count,
+        void* digests);
+
+// hash a file, EINVAL or the error of the failed system call on failure
+HAVAL_EXPORT int haval_hash_file(unsigned int pass_cnt, unsigned int fpt_len, const char* path, void* digest);
+
+// start a streaming hash, NULL if the variant is not supported or memory is exhausted
+HAVAL_EXPORT haval_state* haval_create(unsigned int pass_cnt, unsigned int fpt_len);
+// hash more data
+HAVAL_EXPORT void haval_update(haval_state* state, const void* data, size_t data_len);
+// store the digest and start over
+HAVAL_EXPORT void haval_final(haval_state* state, void* digest);
+// release a state, NULL is ignored
+HAVAL_EXPORT void haval_destroy(haval_state* state);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,94 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "haval.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace haval
+{
+
+// minimum, average and maximum chunk sizes of content-defined chunking
+struct chunk_sizes {
+    std::size_t min = 2 * 1024;
+    std::size_t avg = 8 * 1024;
+    std::size_t max = 64 * 1024;
+};
+
+// a chunk of the input and its digest
+struct chunk_record {
+    std::uint64_t offset;
+    std::uint64_t length;
+    std::string digest;
+};
+
+// content-defined chunking (FastCDC): a gear hash rolled over the input picks chunk
+// boundaries that move with inserted or removed data, and each chunk is hashed as soon
+// as its boundary is found, while it is still in cache; hasher_type is haval<> or
+// dynamic_haval
+template<typename hasher_type>
+class chunker
+{
+public:
+    using size_type = std::size_t;
+
+public:
+    // throws std::invalid_argument unless 0 < min <= avg <= max and avg is at least 64
+    explicit chunker(const chunk_sizes& sizes = chunk_sizes(), hasher_type hasher = hasher_type());
+
+    const chunk_sizes& sizes() const;
+
+    // initialization
+    void start();
+    // updating routine, passes each completed chunk to consume as a chunk_record&&
+    template<typename consume_type>
+    void update(const void* data, size_type data_len, consume_type&& consume);
+    // finalization, passes the last chunk, if any, to consume
+    template<typename consume_type>
+    void end(consume_type&& consume);
+
+private:
+    template<typename consume_type>
+    void end_chunk(const std::uint8_t* data, size_type data_len, consume_type& consume);
+
+private:
+    chunk_sizes m_sizes;
+    // boundary masks before and after the average size
+    std::uint64_t m_small_mask;
+    std::uint64_t m_large_mask;
+    hasher_type m_hasher;
+    std::uint64_t m_offset = 0;
+    size_type m_length = 0;
+    std::uint64_t m_gear = 0;
+};
+
+} // namespace haval
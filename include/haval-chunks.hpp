@@ -0,0 +1,200 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "haval-chunks.h"
+
+#include "haval.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace haval
+{
+
+namespace detail
+{
+
+struct gear_table {
+    std::uint64_t values[256];
+};
+
+// random values for the gear hash, fixed so that boundaries are the same everywhere (splitmix64)
+constexpr gear_table make_gear_table()
+{
+    gear_table table{};
+    std::uint64_t state = 0;
+    for (unsigned int i = 0; i < 256; i++) {
+        state += 0x9E3779B97F4A7C15u;
+        std::uint64_t value = state;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9u;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBu;
+        table.values[i] = value ^ (value >> 31);
+    }
+    return table;
+}
+
+inline const std::uint64_t* gear_values()
+{
+    static constexpr gear_table table = make_gear_table();
+    return table.values;
+}
+
+// mask of the top bit_cnt bits; a gear hash is shifted left, so those depend on the most bytes
+constexpr std::uint64_t gear_mask(unsigned int bit_cnt)
+{
+    return bit_cnt == 0 ? 0 : ~std::uint64_t{0} << (64 - bit_cnt);
+}
+
+constexpr unsigned int floor_log2(std::size_t value)
+{
+    unsigned int result = 0;
+    while (value > 1) {
+        value >>= 1;
+        result++;
+    }
+    return result;
+}
+
+} // namespace detail
+
+template<typename hasher_type>
+chunker<hasher_type>::chunker(const chunk_sizes& sizes, hasher_type hasher) :
+    m_sizes(sizes),
+    m_hasher(std::move(hasher))
+{
+    if (sizes.min == 0 || sizes.min > sizes.avg || sizes.avg > sizes.max || sizes.avg < 64) {
+        throw std::invalid_argument("invalid chunk sizes");
+    }
+
+    // normalized chunking: boundaries are 4 times less likely before the average size
+    // and 4 times more likely after it, which narrows the spread of chunk sizes
+    const unsigned int bit_cnt = detail::floor_log2(sizes.avg);
+    m_small_mask = detail::gear_mask(bit_cnt + 2);
+    m_large_mask = detail::gear_mask(bit_cnt - 2);
+}
+
+template<typename hasher_type>
+const chunk_sizes& chunker<hasher_type>::sizes() const
+{
+    return m_sizes;
+}
+
+// initialization
+template<typename hasher_type>
+void chunker<hasher_type>::start()
+{
+    m_hasher.start();
+    m_offset = 0;
+    m_length = 0;
+    m_gear = 0;
+}
+
+// find chunk boundaries, hashing the data between them
+template<typename hasher_type>
+template<typename consume_type>
+void chunker<hasher_type>::update(const void* data, size_type data_len, consume_type&& consume)
+{
+    const std::uint8_t* const bytes = static_cast<const std::uint8_t*>(data);
+    const std::uint64_t* const gear = detail::gear_values();
+
+    // start of the data not hashed yet
+    size_type chunk_begin = 0;
+    size_type i = 0;
+
+    while (i < data_len) {
+        bool boundary = false;
+
+        if (m_length < m_sizes.min) {
+            // there is no boundary below the minimum size, so these bytes are not even rolled
+            const size_type skip_len = std::min(m_sizes.min - m_length, data_len - i);
+            m_length += skip_len;
+            i += skip_len;
+        } else {
+            const bool small = m_length < m_sizes.avg;
+            const std::uint64_t mask = small ? m_small_mask : m_large_mask;
+            const size_type scan_end = i + std::min((small ? m_sizes.avg : m_sizes.max) - m_length, data_len - i);
+
+            std::uint64_t hash = m_gear;
+            size_type j = i;
+            while (j < scan_end) {
+                hash = (hash << 1) + gear[bytes[j++]];
+                if ((hash & mask) == 0) {
+                    boundary = true;
+                    break;
+                }
+            }
+
+            m_gear = hash;
+            m_length += j - i;
+            i = j;
+        }
+
+        if (boundary || m_length == m_sizes.max) {
+            end_chunk(bytes + chunk_begin, i - chunk_begin, consume);
+            chunk_begin = i;
+        }
+    }
+
+    if (chunk_begin < data_len) {
+        m_hasher.update(bytes + chunk_begin, data_len - chunk_begin);
+    }
+}
+
+// finalization
+template<typename hasher_type>
+template<typename consume_type>
+void chunker<hasher_type>::end(consume_type&& consume)
+{
+    if (m_length > 0) {
+        end_chunk(nullptr, 0, consume);
+    }
+}
+
+// hash the rest of the current chunk, emit it and start the next one
+template<typename hasher_type>
+template<typename consume_type>
+void chunker<hasher_type>::end_chunk(const std::uint8_t* data, size_type data_len, consume_type& consume)
+{
+    if (data_len > 0) {
+        m_hasher.update(data, data_len);
+    }
+
+    chunk_record record{m_offset, m_length, m_hasher.end()};
+
+    m_hasher.start();
+    m_offset += m_length;
+    m_length = 0;
+    m_gear = 0;
+
+    consume(std::move(record));
+}
+
+} // namespace haval
@@ -0,0 +1,75 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "haval-export.h"
+#include "haval-multi.h"
+#include "haval.h"
+
+namespace haval
+{
+
+// compression kernels selectable at run time
+enum class kernel {
+    scalar,
+    sse2,
+    avx2,
+    avx512,
+};
+
+// name of a kernel, as accepted by HAVAL_KERNEL environment variable
+HAVAL_EXPORT const char* kernel_name(kernel k);
+// whether a kernel is both compiled in and supported by the CPU
+HAVAL_EXPORT bool kernel_supported(kernel k);
+// kernel in use; the best supported one unless overridden
+HAVAL_EXPORT kernel active_kernel();
+// pin a kernel, fails if it's not supported
+HAVAL_EXPORT bool set_kernel(kernel k);
+
+namespace detail
+{
+
+// hash a 32-word block per lane, lanes without a block keep their state
+using lane_kernel_type = void (*)(haval_context* context, const std::uint8_t* const* blocks, unsigned int lane_cnt);
+
+// multi-lane kernel of the active kernel set
+HAVAL_EXPORT lane_kernel_type lane_kernel(unsigned int pass_cnt);
+
+// vector word type placeholder resolved at run time
+struct dispatched_word {
+    static constexpr unsigned int lane_cnt = 1;
+};
+
+} // namespace detail
+
+// multi-lane engine using the best kernel for the running CPU
+template<unsigned int pass_cnt, unsigned int fpt_len, unsigned int lanes = 16>
+using dispatched_multi_haval = multi_haval<pass_cnt, fpt_len, lanes, detail::dispatched_word>;
+
+} // namespace haval
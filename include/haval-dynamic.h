@@ -0,0 +1,95 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "haval.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+namespace haval
+{
+
+// HAVAL with the number of passes and the fingerprint length chosen at run time; the
+// pass count selects one of three compression functions once, at construction, and the
+// fingerprint length only matters at finalization, so all 15 variants share three kernels
+class dynamic_haval
+{
+public:
+    using size_type = std::size_t;
+
+    static constexpr size_type stream_buffer_size = 64 * 1024;
+
+public:
+    // throws std::invalid_argument unless pass_cnt is 3, 4 or 5 and fpt_len is 128, 160, 192, 224 or 256
+    dynamic_haval(unsigned int pass_cnt, unsigned int fpt_len);
+
+    unsigned int pass_cnt() const;
+    unsigned int fpt_len() const;
+    size_type result_size() const;
+
+    // initialization
+    void start();
+    // updating routine
+    void update(const void* data, size_type data_len);
+    // finalization
+    void end_to(void* data);
+    std::string end();
+
+    // whether a combination of parameters is supported
+    static bool supported(unsigned int pass_cnt, unsigned int fpt_len);
+
+    // hash a block
+    static std::string hash(unsigned int pass_cnt, unsigned int fpt_len, const void* data, size_type data_len);
+    // hash a string
+    static std::string hash(unsigned int pass_cnt, unsigned int fpt_len, const std::string& data);
+    // hash a stream, reading it in chunks of buffer_size bytes
+    static std::string hash(
+            unsigned int pass_cnt,
+            unsigned int fpt_len,
+            std::istream& stream,
+            size_type buffer_size = stream_buffer_size);
+    // hash a file, throws std::system_error on failure
+    static std::string hash_file(unsigned int pass_cnt, unsigned int fpt_len, const char* path);
+    // hash the rest of an open file, throws std::system_error on failure
+    static std::string hash_fd(unsigned int pass_cnt, unsigned int fpt_len, int fd);
+
+private:
+    using compress_function = void (*)(detail::word_t* fingerprint, const std::uint8_t* block);
+
+private:
+    compress_function m_compress;
+    unsigned int m_pass_cnt;
+    unsigned int m_fpt_len;
+    detail::haval_context m_context;
+};
+
+} // namespace haval
@@ -0,0 +1,176 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "haval-dynamic.h"
+
+#include "haval.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+namespace haval
+{
+
+inline dynamic_haval::dynamic_haval(unsigned int pass_cnt, unsigned int fpt_len) :
+    m_compress(nullptr),
+    m_pass_cnt(pass_cnt),
+    m_fpt_len(fpt_len),
+    m_context()
+{
+    if (!supported(pass_cnt, fpt_len)) {
+        throw std::invalid_argument("unsupported HAVAL variant");
+    }
+
+    static constexpr compress_function compress_functions[] = {
+            &detail::compress<3>,
+            &detail::compress<4>,
+            &detail::compress<5>,
+    };
+    m_compress = compress_functions[pass_cnt - 3];
+}
+
+inline unsigned int dynamic_haval::pass_cnt() const
+{
+    return m_pass_cnt;
+}
+
+inline unsigned int dynamic_haval::fpt_len() const
+{
+    return m_fpt_len;
+}
+
+inline dynamic_haval::size_type dynamic_haval::result_size() const
+{
+    return m_fpt_len >> 3;
+}
+
+// initialization
+inline void dynamic_haval::start()
+{
+    detail::start(m_context);
+}
+
+// hash a string of specified length
+inline void dynamic_haval::update(const void* data, size_type data_len)
+{
+    detail::update(m_context, static_cast<const std::uint8_t*>(data), data_len, [this](const std::uint8_t* block) {
+        m_compress(m_context.fingerprint, block);
+    });
+}
+
+// finalization
+inline void dynamic_haval::end_to(void* data)
+{
+    assert(data != nullptr);
+
+    detail::pad(m_context, m_pass_cnt, m_fpt_len, [this](const std::uint8_t* block) {
+        m_compress(m_context.fingerprint, block);
+    });
+
+    // tailor the last output
+    detail::tailor(m_context.fingerprint, m_fpt_len);
+
+    // translate and save the final fingerprint
+    detail::uint2ch(m_context.fingerprint, static_cast<std::uint8_t*>(data), m_fpt_len >> 5);
+
+    // clear the state information
+    std::memset(&m_context, 0, sizeof(m_context));
+}
+
+// finalization
+inline std::string dynamic_haval::end()
+{
+    std::string result(result_size(), '\0');
+    end_to(&result[0]);
+    return result;
+}
+
+inline bool dynamic_haval::supported(unsigned int pass_cnt, unsigned int fpt_len)
+{
+    return pass_cnt >= 3 && pass_cnt <= 5 && fpt_len >= 128 && fpt_len <= 256 && fpt_len % 32 == 0;
+}
+
+// hash a block
+inline std::string dynamic_haval::hash(unsigned int pass_cnt, unsigned int fpt_len, const void* data, size_type data_len)
+{
+    dynamic_haval context(pass_cnt, fpt_len);
+    context.start();
+    context.update(data, data_len);
+    return context.end();
+}
+
+// hash a string
+inline std::string dynamic_haval::hash(unsigned int pass_cnt, unsigned int fpt_len, const std::string& data)
+{
+    return hash(pass_cnt, fpt_len, data.data(), data.size());
+}
+
+// hash a stream, reading it in chunks of buffer_size bytes
+inline std::string dynamic_haval::hash(
+        unsigned int pass_cnt,
+        unsigned int fpt_len,
+        std::istream& stream,
+        size_type buffer_size)
+{
+    assert(buffer_size > 0);
+
+    dynamic_haval context(pass_cnt, fpt_len);
+    context.start();
+
+    const size_type chunk_size = detail::block_aligned_size(buffer_size);
+    const std::unique_ptr<char[]> chunk(new char[chunk_size]);
+
+    detail::update_from_stream(context, stream, chunk.get(), static_cast<std::streamsize>(chunk_size));
+    return context.end();
+}
+
+// hash a file
+inline std::string dynamic_haval::hash_file(unsigned int pass_cnt, unsigned int fpt_len, const char* path)
+{
+    dynamic_haval context(pass_cnt, fpt_len);
+    const detail::fd_guard file{detail::open_file(path)};
+    context.start();
+    detail::update_from_fd(context, file.fd);
+    return context.end();
+}
+
+// hash the rest of an open file
+inline std::string dynamic_haval::hash_fd(unsigned int pass_cnt, unsigned int fpt_len, int fd)
+{
+    dynamic_haval context(pass_cnt, fpt_len);
+    context.start();
+    detail::update_from_fd(context, fd);
+    return context.end();
+}
+
+} // namespace haval
@@ -0,0 +1,56 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "haval-export.h"
+#include "haval.h"
+
+// all 15 variants are compiled once into haval_core; consumers linking it
+// call into the library instead of instantiating the rounds themselves
+
+namespace haval
+{
+
+extern template class HAVAL_EXPORT haval<3, 128>;
+extern template class HAVAL_EXPORT haval<3, 160>;
+extern template class HAVAL_EXPORT haval<3, 192>;
+extern template class HAVAL_EXPORT haval<3, 224>;
+extern template class HAVAL_EXPORT haval<3, 256>;
+extern template class HAVAL_EXPORT haval<4, 128>;
+extern template class HAVAL_EXPORT haval<4, 160>;
+extern template class HAVAL_EXPORT haval<4, 192>;
+extern template class HAVAL_EXPORT haval<4, 224>;
+extern template class HAVAL_EXPORT haval<4, 256>;
+extern template class HAVAL_EXPORT haval<5, 128>;
+extern template class HAVAL_EXPORT haval<5, 160>;
+extern template class HAVAL_EXPORT haval<5, 192>;
+extern template class HAVAL_EXPORT haval<5, 224>;
+extern template class HAVAL_EXPORT haval<5, 256>;
+
+} // namespace haval
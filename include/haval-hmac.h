@@ -0,0 +1,84 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "haval.h"
+
+namespace haval
+{
+
+// keyed hashing as defined by RFC 2104, with HAVAL as the hash function
+template<unsigned int pass_cnt, unsigned int fpt_len>
+class hmac
+{
+public:
+    using impl_type = haval<pass_cnt, fpt_len>;
+    using size_type = typename impl_type::size_type;
+
+    static constexpr size_type block_size = 128;
+    static constexpr size_type result_size = impl_type::result_size;
+
+    // a prepared key; holds the hash states after absorbing the padded key,
+    // immutable once constructed and safe to share between threads
+    class key
+    {
+    public:
+        key(const void* data, size_type data_len);
+        explicit key(const std::string& data);
+
+    private:
+        friend class hmac;
+
+        impl_type m_inner;
+        impl_type m_outer;
+    };
+
+public:
+    // the key must outlive the object
+    explicit hmac(const key& k);
+
+    // initialization
+    void start();
+    // updating routine
+    void update(const void* data, size_type data_len);
+    // finalization
+    void end_to(void* data);
+    std::string end();
+
+    // authenticate a block
+    static std::string hash(const key& k, const void* data, size_type data_len);
+    // authenticate a string
+    static std::string hash(const key& k, const std::string& data);
+
+private:
+    const key* m_key;
+    impl_type m_impl;
+};
+
+} // namespace haval
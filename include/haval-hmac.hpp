@@ -0,0 +1,146 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "haval-hmac.h"
+
+#include "haval.hpp"
+
+#include <cassert>
+#include <cstring>
+
+namespace haval
+{
+
+// prepare a key
+template<unsigned int pass_cnt, unsigned int fpt_len>
+hmac<pass_cnt, fpt_len>::key::key(const void* data, size_type data_len)
+{
+    assert(data != nullptr || data_len == 0);
+
+    std::uint8_t block[block_size] = {};
+
+    // keys longer than a block are hashed first
+    if (data_len > block_size) {
+        impl_type context;
+        context.start();
+        context.update(data, data_len);
+        context.end_to(block);
+    } else if (data_len > 0) {
+        std::memcpy(block, data, data_len);
+    }
+
+    for (auto& c : block) {
+        c ^= 0x36;
+    }
+    m_inner.start();
+    m_inner.update(block, block_size);
+
+    for (auto& c : block) {
+        c ^= 0x36 ^ 0x5C;
+    }
+    m_outer.start();
+    m_outer.update(block, block_size);
+
+    std::memset(block, 0, sizeof(block));
+}
+
+// prepare a key
+template<unsigned int pass_cnt, unsigned int fpt_len>
+hmac<pass_cnt, fpt_len>::key::key(const std::string& data) :
+    key(data.data(), data.size())
+{
+}
+
+template<unsigned int pass_cnt, unsigned int fpt_len>
+hmac<pass_cnt, fpt_len>::hmac(const key& k) :
+    m_key(&k),
+    m_impl()
+{
+}
+
+// initialization, resumes from the inner key state
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void hmac<pass_cnt, fpt_len>::start()
+{
+    m_impl = m_key->m_inner;
+}
+
+// authenticate a string of specified length.
+// to be used in conjunction with start and end_to.
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void hmac<pass_cnt, fpt_len>::update(const void* data, size_type data_len)
+{
+    m_impl.update(data, data_len);
+}
+
+// finalization
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void hmac<pass_cnt, fpt_len>::end_to(void* data)
+{
+    assert(data != nullptr);
+
+    std::uint8_t inner_digest[result_size];
+    m_impl.end_to(inner_digest);
+
+    // the outer hash only has the inner digest left to absorb
+    m_impl = m_key->m_outer;
+    m_impl.update(inner_digest, result_size);
+    m_impl.end_to(data);
+
+    std::memset(inner_digest, 0, sizeof(inner_digest));
+}
+
+// finalization
+template<unsigned int pass_cnt, unsigned int fpt_len>
+std::string hmac<pass_cnt, fpt_len>::end()
+{
+    std::string result(result_size, '\0');
+    end_to(&result[0]);
+    return result;
+}
+
+// authenticate a block
+template<unsigned int pass_cnt, unsigned int fpt_len>
+std::string hmac<pass_cnt, fpt_len>::hash(const key& k, const void* data, size_type data_len)
+{
+    hmac<pass_cnt, fpt_len> context(k);
+    context.start();
+    context.update(data, data_len);
+    return context.end();
+}
+
+// authenticate a string
+template<unsigned int pass_cnt, unsigned int fpt_len>
+std::string hmac<pass_cnt, fpt_len>::hash(const key& k, const std::string& data)
+{
+    return hash(k, data.data(), data.size());
+}
+
+} // namespace haval
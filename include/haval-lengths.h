@@ -0,0 +1,113 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "haval.h"
+
+#include <array>
+#include <cstddef>
+#include <string>
+
+namespace haval
+{
+
+// HAVAL with all five fingerprint lengths at once; the lengths only differ in the
+// tail of the last block and in tailoring, so the data is compressed once
+template<unsigned int pass_cnt>
+class multi_length
+{
+    static_assert(pass_cnt >= 3, "");
+    static_assert(pass_cnt <= 5, "");
+
+public:
+    using size_type = std::size_t;
+
+    static constexpr size_type length_cnt = 5;
+
+    // digests for 128, 160, 192, 224 and 256 bits, in that order
+    using digests_type = std::array<std::string, length_cnt>;
+
+    // fingerprint length of a digest index
+    static constexpr unsigned int fpt_len(size_type index);
+
+public:
+    // initialization
+    void start();
+    // updating routine
+    void update(const void* data, size_type data_len);
+    // finalization
+    digests_type end();
+
+    // hash a block
+    static digests_type hash(const void* data, size_type data_len);
+    // hash a string
+    static digests_type hash(const std::string& data);
+    // hash a file, throws std::system_error on failure
+    static digests_type hash_file(const char* path);
+    // hash the rest of an open file, throws std::system_error on failure
+    static digests_type hash_fd(int fd);
+
+private:
+    detail::haval_context m_context;
+};
+
+// all 15 variants of HAVAL over a single read of the data: the 3, 4 and 5 pass
+// chains take turns on each chunk while it is still in cache
+class all_variants
+{
+public:
+    using size_type = std::size_t;
+
+    // digests indexed by the number of passes less 3, then as in multi_length
+    using digests_type = std::array<std::array<std::string, 5>, 3>;
+
+public:
+    // initialization
+    void start();
+    // updating routine
+    void update(const void* data, size_type data_len);
+    // finalization
+    digests_type end();
+
+    // hash a block
+    static digests_type hash(const void* data, size_type data_len);
+    // hash a string
+    static digests_type hash(const std::string& data);
+    // hash a file, throws std::system_error on failure
+    static digests_type hash_file(const char* path);
+    // hash the rest of an open file, throws std::system_error on failure
+    static digests_type hash_fd(int fd);
+
+private:
+    multi_length<3> m_pass3;
+    multi_length<4> m_pass4;
+    multi_length<5> m_pass5;
+};
+
+} // namespace haval
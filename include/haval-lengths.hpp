@@ -0,0 +1,190 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "haval-lengths.h"
+
+#include "haval.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace haval
+{
+
+namespace detail
+{
+
+// chunk of data all chains hash before moving on, small enough to stay in L2
+constexpr std::size_t all_variants_chunk_size = 64 * 1024;
+
+} // namespace detail
+
+template<unsigned int pass_cnt>
+constexpr unsigned int multi_length<pass_cnt>::fpt_len(size_type index)
+{
+    return static_cast<unsigned int>(128 + index * 32);
+}
+
+// initialization
+template<unsigned int pass_cnt>
+void multi_length<pass_cnt>::start()
+{
+    detail::start(m_context);
+}
+
+// hash a string of specified length
+template<unsigned int pass_cnt>
+void multi_length<pass_cnt>::update(const void* data, size_type data_len)
+{
+    detail::update(m_context, static_cast<const std::uint8_t*>(data), data_len, [this](const std::uint8_t* block) {
+        detail::compress<pass_cnt>(m_context.fingerprint, block);
+    });
+}
+
+// finalization, each length pads its own copy of the chained state
+template<unsigned int pass_cnt>
+typename multi_length<pass_cnt>::digests_type multi_length<pass_cnt>::end()
+{
+    digests_type result;
+
+    for (size_type i = 0; i < length_cnt; i++) {
+        detail::haval_context context = m_context;
+        detail::pad(context, pass_cnt, fpt_len(i), [&context](const std::uint8_t* block) {
+            detail::compress<pass_cnt>(context.fingerprint, block);
+        });
+
+        detail::tailor(context.fingerprint, fpt_len(i));
+
+        result[i].resize(fpt_len(i) >> 3);
+        detail::uint2ch(context.fingerprint, reinterpret_cast<std::uint8_t*>(&result[i][0]), fpt_len(i) >> 5);
+    }
+
+    // clear the state information
+    std::memset(&m_context, 0, sizeof(m_context));
+
+    return result;
+}
+
+// hash a block
+template<unsigned int pass_cnt>
+typename multi_length<pass_cnt>::digests_type multi_length<pass_cnt>::hash(const void* data, size_type data_len)
+{
+    multi_length<pass_cnt> context;
+    context.start();
+    context.update(data, data_len);
+    return context.end();
+}
+
+// hash a string
+template<unsigned int pass_cnt>
+typename multi_length<pass_cnt>::digests_type multi_length<pass_cnt>::hash(const std::string& data)
+{
+    return hash(data.data(), data.size());
+}
+
+// hash a file
+template<unsigned int pass_cnt>
+typename multi_length<pass_cnt>::digests_type multi_length<pass_cnt>::hash_file(const char* path)
+{
+    const detail::fd_guard file{detail::open_file(path)};
+    return hash_fd(file.fd);
+}
+
+// hash the rest of an open file
+template<unsigned int pass_cnt>
+typename multi_length<pass_cnt>::digests_type multi_length<pass_cnt>::hash_fd(int fd)
+{
+    multi_length<pass_cnt> context;
+    context.start();
+    detail::update_from_fd(context, fd);
+    return context.end();
+}
+
+// initialization
+inline void all_variants::start()
+{
+    m_pass3.start();
+    m_pass4.start();
+    m_pass5.start();
+}
+
+// hash a string of specified length
+inline void all_variants::update(const void* vdata, size_type data_len)
+{
+    const std::uint8_t* data = static_cast<const std::uint8_t*>(vdata);
+
+    while (data_len > 0) {
+        const size_type chunk_len = std::min(data_len, detail::all_variants_chunk_size);
+        m_pass3.update(data, chunk_len);
+        m_pass4.update(data, chunk_len);
+        m_pass5.update(data, chunk_len);
+        data += chunk_len;
+        data_len -= chunk_len;
+    }
+}
+
+// finalization
+inline all_variants::digests_type all_variants::end()
+{
+    return {{m_pass3.end(), m_pass4.end(), m_pass5.end()}};
+}
+
+// hash a block
+inline all_variants::digests_type all_variants::hash(const void* data, size_type data_len)
+{
+    all_variants context;
+    context.start();
+    context.update(data, data_len);
+    return context.end();
+}
+
+// hash a string
+inline all_variants::digests_type all_variants::hash(const std::string& data)
+{
+    return hash(data.data(), data.size());
+}
+
+// hash a file
+inline all_variants::digests_type all_variants::hash_file(const char* path)
+{
+    const detail::fd_guard file{detail::open_file(path)};
+    return hash_fd(file.fd);
+}
+
+// hash the rest of an open file
+inline all_variants::digests_type all_variants::hash_fd(int fd)
+{
+    all_variants context;
+    context.start();
+    detail::update_from_fd(context, fd);
+    return context.end();
+}
+
+} // namespace haval
@@ -0,0 +1,96 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "haval.h"
+
+namespace haval
+{
+
+namespace detail
+{
+
+// widest vector word available at compile time for the given number of lanes
+template<unsigned int lanes>
+struct native_lane_word;
+
+} // namespace detail
+
+// hashes several independent messages at once, one per vector lane
+template<
+        unsigned int pass_cnt,
+        unsigned int fpt_len,
+        unsigned int lanes,
+        typename word_type = typename detail::native_lane_word<lanes>::type>
+class multi_haval
+{
+    static_assert(pass_cnt >= 3, "");
+    static_assert(pass_cnt <= 5, "");
+
+    static_assert(fpt_len >= 128, "");
+    static_assert(fpt_len <= 256, "");
+    static_assert(fpt_len % 32 == 0, "");
+
+    static_assert(lanes > 0, "");
+    static_assert(lanes % word_type::lane_cnt == 0, "");
+
+public:
+    using size_type = std::size_t;
+
+    static constexpr size_type result_size = fpt_len >> 3;
+    static constexpr unsigned int lane_cnt = lanes;
+
+public:
+    // initialization of every lane
+    void start();
+    // updating routine, one buffer per lane
+    void update(const void* const* data, const size_type* data_len);
+    // finalization, one output buffer per lane
+    void end_to(void* const* data);
+
+    // hash a block per lane
+    static void hash(const void* const* data, const size_type* data_len, void* const* results);
+
+private:
+    void hash_blocks(const std::uint8_t* const* blocks);
+
+private:
+    detail::haval_context m_context[lanes];
+};
+
+// hash count independent messages and write count * result_size bytes of digests to results;
+// messages taking the same number of blocks are hashed together, one per lane
+template<
+        unsigned int pass_cnt,
+        unsigned int fpt_len,
+        unsigned int lanes = 16,
+        typename word_type = typename detail::native_lane_word<lanes>::type>
+void hash_many(const void* const* data, const std::size_t* data_len, std::size_t count, void* results);
+
+} // namespace haval
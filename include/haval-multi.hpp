@@ -0,0 +1,658 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "haval-multi.h"
+
+#include "haval.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// 32-bit MSVC can't pass vector arguments by value
+#if !defined(_MSC_VER) || !defined(_M_IX86)
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define HAVAL_HAVE_SSE2
+#endif
+
+#ifdef __AVX2__
+#define HAVAL_HAVE_AVX2
+#endif
+
+#ifdef __AVX512F__
+#define HAVAL_HAVE_AVX512
+#endif
+
+#endif
+
+#if defined(HAVAL_HAVE_AVX2) || defined(HAVAL_HAVE_AVX512)
+#include <immintrin.h>
+#elif defined(HAVAL_HAVE_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace haval
+{
+
+namespace detail
+{
+
+// a vector of words emulated with plain arrays
+template<unsigned int lanes>
+struct portable_word {
+    static constexpr unsigned int lane_cnt = lanes;
+
+    static portable_word load(const word_t* p)
+    {
+        portable_word result;
+        std::memcpy(result.v, p, sizeof(result.v));
+        return result;
+    }
+
+    void store(word_t* p) const
+    {
+        std::memcpy(p, v, sizeof(v));
+    }
+
+    word_t v[lanes];
+};
+
+template<unsigned int lanes>
+portable_word<lanes> operator&(portable_word<lanes> a, const portable_word<lanes>& b)
+{
+    for (unsigned int i = 0; i < lanes; i++) {
+        a.v[i] &= b.v[i];
+    }
+    return a;
+}
+
+template<unsigned int lanes>
+portable_word<lanes> operator|(portable_word<lanes> a, const portable_word<lanes>& b)
+{
+    for (unsigned int i = 0; i < lanes; i++) {
+        a.v[i] |= b.v[i];
+    }
+    return a;
+}
+
+template<unsigned int lanes>
+portable_word<lanes> operator^(portable_word<lanes> a, const portable_word<lanes>& b)
+{
+    for (unsigned int i = 0; i < lanes; i++) {
+        a.v[i] ^= b.v[i];
+    }
+    return a;
+}
+
+template<unsigned int lanes>
+portable_word<lanes> operator~(portable_word<lanes> a)
+{
+    for (unsigned int i = 0; i < lanes; i++) {
+        a.v[i] = ~a.v[i];
+    }
+    return a;
+}
+
+template<unsigned int lanes>
+portable_word<lanes> operator+(portable_word<lanes> a, const portable_word<lanes>& b)
+{
+    for (unsigned int i = 0; i < lanes; i++) {
+        a.v[i] += b.v[i];
+    }
+    return a;
+}
+
+template<unsigned int lanes>
+portable_word<lanes> operator+(portable_word<lanes> a, word_t b)
+{
+    for (unsigned int i = 0; i < lanes; i++) {
+        a.v[i] += b;
+    }
+    return a;
+}
+
+template<unsigned int lanes>
+portable_word<lanes> operator>>(portable_word<lanes> a, word_t n)
+{
+    for (unsigned int i = 0; i < lanes; i++) {
+        a.v[i] >>= n;
+    }
+    return a;
+}
+
+template<unsigned int lanes>
+portable_word<lanes> operator<<(portable_word<lanes> a, word_t n)
+{
+    for (unsigned int i = 0; i < lanes; i++) {
+        a.v[i] <<= n;
+    }
+    return a;
+}
+
+#ifdef HAVAL_HAVE_SSE2
+
+// 4 words in an SSE2 register
+template<typename tag_type = void>
+struct basic_sse2_word {
+    static constexpr unsigned int lane_cnt = 4;
+
+    static basic_sse2_word load(const word_t* p)
+    {
+        return {_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))};
+    }
+
+    void store(word_t* p) const
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+    }
+
+    __m128i v;
+};
+
+using sse2_word = basic_sse2_word<>;
+
+template<typename tag_type>
+inline basic_sse2_word<tag_type> operator&(basic_sse2_word<tag_type> a, basic_sse2_word<tag_type> b)
+{
+    return {_mm_and_si128(a.v, b.v)};
+}
+
+template<typename tag_type>
+inline basic_sse2_word<tag_type> operator|(basic_sse2_word<tag_type> a, basic_sse2_word<tag_type> b)
+{
+    return {_mm_or_si128(a.v, b.v)};
+}
+
+template<typename tag_type>
+inline basic_sse2_word<tag_type> operator^(basic_sse2_word<tag_type> a, basic_sse2_word<tag_type> b)
+{
+    return {_mm_xor_si128(a.v, b.v)};
+}
+
+template<typename tag_type>
+inline basic_sse2_word<tag_type> operator~(basic_sse2_word<tag_type> a)
+{
+    return {_mm_xor_si128(a.v, _mm_set1_epi32(-1))};
+}
+
+template<typename tag_type>
+inline basic_sse2_word<tag_type> operator+(basic_sse2_word<tag_type> a, basic_sse2_word<tag_type> b)
+{
+    return {_mm_add_epi32(a.v, b.v)};
+}
+
+template<typename tag_type>
+inline basic_sse2_word<tag_type> operator+(basic_sse2_word<tag_type> a, word_t b)
+{
+    return {_mm_add_epi32(a.v, _mm_set1_epi32(static_cast<int>(b)))};
+}
+
+template<typename tag_type>
+inline basic_sse2_word<tag_type> operator>>(basic_sse2_word<tag_type> a, word_t n)
+{
+    return {_mm_srli_epi32(a.v, static_cast<int>(n))};
+}
+
+template<typename tag_type>
+inline basic_sse2_word<tag_type> operator<<(basic_sse2_word<tag_type> a, word_t n)
+{
+    return {_mm_slli_epi32(a.v, static_cast<int>(n))};
+}
+
+#endif
+
+#ifdef HAVAL_HAVE_AVX2
+
+// 8 words in an AVX2 register
+template<typename tag_type = void>
+struct basic_avx2_word {
+    static constexpr unsigned int lane_cnt = 8;
+
+    static basic_avx2_word load(const word_t* p)
+    {
+        return {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))};
+    }
+
+    void store(word_t* p) const
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+    }
+
+    __m256i v;
+};
+
+using avx2_word = basic_avx2_word<>;
+
+template<typename tag_type>
+inline basic_avx2_word<tag_type> operator&(basic_avx2_word<tag_type> a, basic_avx2_word<tag_type> b)
+{
+    return {_mm256_and_si256(a.v, b.v)};
+}
+
+template<typename tag_type>
+inline basic_avx2_word<tag_type> operator|(basic_avx2_word<tag_type> a, basic_avx2_word<tag_type> b)
+{
+    return {_mm256_or_si256(a.v, b.v)};
+}
+
+template<typename tag_type>
+inline basic_avx2_word<tag_type> operator^(basic_avx2_word<tag_type> a, basic_avx2_word<tag_type> b)
+{
+    return {_mm256_xor_si256(a.v, b.v)};
+}
+
+template<typename tag_type>
+inline basic_avx2_word<tag_type> operator~(basic_avx2_word<tag_type> a)
+{
+    return {_mm256_xor_si256(a.v, _mm256_set1_epi32(-1))};
+}
+
+template<typename tag_type>
+inline basic_avx2_word<tag_type> operator+(basic_avx2_word<tag_type> a, basic_avx2_word<tag_type> b)
+{
+    return {_mm256_add_epi32(a.v, b.v)};
+}
+
+template<typename tag_type>
+inline basic_avx2_word<tag_type> operator+(basic_avx2_word<tag_type> a, word_t b)
+{
+    return {_mm256_add_epi32(a.v, _mm256_set1_epi32(static_cast<int>(b)))};
+}
+
+template<typename tag_type>
+inline basic_avx2_word<tag_type> operator>>(basic_avx2_word<tag_type> a, word_t n)
+{
+    return {_mm256_srli_epi32(a.v, static_cast<int>(n))};
+}
+
+template<typename tag_type>
+inline basic_avx2_word<tag_type> operator<<(basic_avx2_word<tag_type> a, word_t n)
+{
+    return {_mm256_slli_epi32(a.v, static_cast<int>(n))};
+}
+
+#endif
+
+#ifdef HAVAL_HAVE_AVX512
+
+// 16 words in an AVX-512 register
+template<typename tag_type = void>
+struct basic_avx512_word {
+    static constexpr unsigned int lane_cnt = 16;
+
+    static basic_avx512_word load(const word_t* p)
+    {
+        return {_mm512_loadu_si512(p)};
+    }
+
+    void store(word_t* p) const
+    {
+        _mm512_storeu_si512(p, v);
+    }
+
+    __m512i v;
+};
+
+using avx512_word = basic_avx512_word<>;
+
+template<typename tag_type>
+inline basic_avx512_word<tag_type> operator&(basic_avx512_word<tag_type> a, basic_avx512_word<tag_type> b)
+{
+    return {_mm512_and_si512(a.v, b.v)};
+}
+
+template<typename tag_type>
+inline basic_avx512_word<tag_type> operator|(basic_avx512_word<tag_type> a, basic_avx512_word<tag_type> b)
+{
+    return {_mm512_or_si512(a.v, b.v)};
+}
+
+template<typename tag_type>
+inline basic_avx512_word<tag_type> operator^(basic_avx512_word<tag_type> a, basic_avx512_word<tag_type> b)
+{
+    return {_mm512_xor_si512(a.v, b.v)};
+}
+
+template<typename tag_type>
+inline basic_avx512_word<tag_type> operator~(basic_avx512_word<tag_type> a)
+{
+    return {_mm512_xor_si512(a.v, _mm512_set1_epi32(-1))};
+}
+
+template<typename tag_type>
+inline basic_avx512_word<tag_type> operator+(basic_avx512_word<tag_type> a, basic_avx512_word<tag_type> b)
+{
+    return {_mm512_add_epi32(a.v, b.v)};
+}
+
+template<typename tag_type>
+inline basic_avx512_word<tag_type> operator+(basic_avx512_word<tag_type> a, word_t b)
+{
+    return {_mm512_add_epi32(a.v, _mm512_set1_epi32(static_cast<int>(b)))};
+}
+
+template<typename tag_type>
+inline basic_avx512_word<tag_type> operator>>(basic_avx512_word<tag_type> a, word_t n)
+{
+    return {_mm512_srli_epi32(a.v, static_cast<unsigned int>(n))};
+}
+
+template<typename tag_type>
+inline basic_avx512_word<tag_type> operator<<(basic_avx512_word<tag_type> a, word_t n)
+{
+    return {_mm512_slli_epi32(a.v, static_cast<unsigned int>(n))};
+}
+
+// AVX-512 has a native rotation, no need to combine two shifts
+template<typename tag_type>
+inline basic_avx512_word<tag_type> rotate_right(basic_avx512_word<tag_type> x, word_t n)
+{
+    return {_mm512_maskz_rorv_epi32(0xFFFF, x.v, _mm512_set1_epi32(static_cast<int>(n)))};
+}
+
+#endif
+
+#if defined(HAVAL_HAVE_SSE2)
+using native_word_4 = sse2_word;
+#else
+using native_word_4 = portable_word<4>;
+#endif
+
+#if defined(HAVAL_HAVE_AVX2)
+using native_word_8 = avx2_word;
+#else
+using native_word_8 = native_word_4;
+#endif
+
+#if defined(HAVAL_HAVE_AVX512)
+using native_word_16 = avx512_word;
+#else
+using native_word_16 = native_word_8;
+#endif
+
+template<unsigned int lanes>
+struct native_lane_word {
+    using type = typename std::conditional<
+            lanes % 16 == 0,
+            native_word_16,
+            typename std::conditional<
+                    lanes % 8 == 0,
+                    native_word_8,
+                    typename std::conditional<lanes % 4 == 0, native_word_4, portable_word<lanes>>::type>::type>::type;
+};
+
+// hash a 32-word block per lane for up to word_type::lane_cnt lanes,
+// lanes without a block keep their state
+template<unsigned int pass_cnt, typename word_type>
+void hash_lanes(haval_context* context, const std::uint8_t* const* blocks, unsigned int lane_cnt)
+{
+    constexpr unsigned int word_lane_cnt = word_type::lane_cnt;
+
+    assert(lane_cnt <= word_lane_cnt);
+
+    // transpose the input so that every vector holds the same word of all lanes
+    word_t scratch[32][word_lane_cnt];
+    for (unsigned int l = 0; l < word_lane_cnt; l++) {
+        const std::uint8_t* sp = l < lane_cnt && blocks[l] != nullptr ? blocks[l] : padding;
+        for (unsigned int i = 0; i < 32; i++) {
+            scratch[i][l] = load_le32<word_type>(sp + i * 4);
+        }
+    }
+
+    word_type w[32];
+    for (unsigned int i = 0; i < 32; i++) {
+        w[i] = word_type::load(scratch[i]);
+    }
+
+    word_type t[8];
+    for (unsigned int i = 0; i < 8; i++) {
+        for (unsigned int l = 0; l < word_lane_cnt; l++) {
+            scratch[i][l] = l < lane_cnt ? context[l].fingerprint[i] : 0;
+        }
+        t[i] = word_type::load(scratch[i]);
+    }
+
+    hash_block<pass_cnt>(t[0], t[1], t[2], t[3], t[4], t[5], t[6], t[7], w);
+
+    for (unsigned int i = 0; i < 8; i++) {
+        t[i].store(scratch[i]);
+        for (unsigned int l = 0; l < lane_cnt; l++) {
+            if (blocks[l] != nullptr) {
+                context[l].fingerprint[i] += scratch[i][l];
+            }
+        }
+    }
+}
+
+// hash a 32-word block per lane for any number of lanes
+template<unsigned int pass_cnt, typename word_type>
+struct lanes_hasher {
+    static void hash(haval_context* context, const std::uint8_t* const* blocks, unsigned int lane_cnt)
+    {
+        for (unsigned int l = 0; l < lane_cnt; l += word_type::lane_cnt) {
+            const unsigned int group_cnt = lane_cnt - l < word_type::lane_cnt ? lane_cnt - l : word_type::lane_cnt;
+            hash_lanes<pass_cnt, word_type>(&context[l], &blocks[l], group_cnt);
+        }
+    }
+};
+
+} // namespace detail
+
+// initialization
+template<unsigned int pass_cnt, unsigned int fpt_len, unsigned int lanes, typename word_type>
+void multi_haval<pass_cnt, fpt_len, lanes, word_type>::start()
+{
+    for (auto& context : m_context) {
+        detail::start(context);
+    }
+}
+
+// hash a string of specified length in every lane.
+// to be used in conjunction with start and end_to.
+template<unsigned int pass_cnt, unsigned int fpt_len, unsigned int lanes, typename word_type>
+void multi_haval<pass_cnt, fpt_len, lanes, word_type>::update(const void* const* data, const size_type* data_len)
+{
+    const std::uint8_t* src[lanes];
+    size_type src_len[lanes];
+    size_type rmd_len[lanes];
+    const std::uint8_t* blocks[lanes];
+
+    for (unsigned int l = 0; l < lanes; l++) {
+        auto& context = m_context[l];
+
+        src[l] = static_cast<const std::uint8_t*>(data[l]);
+        src_len[l] = data_len[l];
+        blocks[l] = nullptr;
+
+        // calculate the number of bytes in the remainder
+        rmd_len[l] = static_cast<size_type>(context.count & 0x7F);
+
+        // update the number of bytes
+        context.count += src_len[l];
+
+        // complete the remainder first
+        if (rmd_len[l] != 0 && rmd_len[l] + src_len[l] >= 128) {
+            const size_type fill_len = 128 - rmd_len[l];
+            std::memcpy(&context.remainder[rmd_len[l]], src[l], fill_len);
+            src[l] += fill_len;
+            src_len[l] -= fill_len;
+            rmd_len[l] = 0;
+            blocks[l] = context.remainder;
+        }
+    }
+
+    // hash blocks while at least one lane has some, straight from the input
+    for (;;) {
+        bool have_blocks = false;
+        for (unsigned int l = 0; l < lanes; l++) {
+            if (blocks[l] == nullptr && src_len[l] >= 128) {
+                blocks[l] = src[l];
+                src[l] += 128;
+                src_len[l] -= 128;
+            }
+            have_blocks = have_blocks || blocks[l] != nullptr;
+        }
+
+        if (!have_blocks) {
+            break;
+        }
+
+        hash_blocks(blocks);
+
+        for (auto& block : blocks) {
+            block = nullptr;
+        }
+    }
+
+    // save the remaining input chars
+    for (unsigned int l = 0; l < lanes; l++) {
+        if (src_len[l] != 0) {
+            std::memcpy(&m_context[l].remainder[rmd_len[l]], src[l], src_len[l]);
+        }
+    }
+}
+
+// finalization
+template<unsigned int pass_cnt, unsigned int fpt_len, unsigned int lanes, typename word_type>
+void multi_haval<pass_cnt, fpt_len, lanes, word_type>::end_to(void* const* data)
+{
+    std::uint8_t tails[lanes][10];
+    const void* pad[lanes];
+    size_type pad_len[lanes];
+    const void* tail[lanes];
+    size_type tail_len[lanes];
+
+    for (unsigned int l = 0; l < lanes; l++) {
+        assert(data[l] != nullptr);
+
+        detail::make_tail<pass_cnt, fpt_len>(m_context[l].count, tails[l]);
+
+        // pad out to 118 mod 128
+        const size_type rmd_len = static_cast<size_type>(m_context[l].count & 0x7F);
+        pad[l] = detail::padding;
+        pad_len[l] = (rmd_len < 118) ? (118 - rmd_len) : (246 - rmd_len);
+
+        tail[l] = tails[l];
+        tail_len[l] = 10;
+    }
+
+    update(pad, pad_len);
+
+    // append the version number, the number of passes,
+    // the fingerprint length and the number of bits
+    update(tail, tail_len);
+
+    for (unsigned int l = 0; l < lanes; l++) {
+        // tailor the last output
+        detail::tailor<fpt_len>(m_context[l].fingerprint);
+
+        // translate and save the final fingerprint
+        detail::uint2ch(m_context[l].fingerprint, static_cast<std::uint8_t*>(data[l]), fpt_len >> 5);
+    }
+
+    // clear the state information
+    std::memset(m_context, 0, sizeof(m_context));
+}
+
+// hash a block per lane
+template<unsigned int pass_cnt, unsigned int fpt_len, unsigned int lanes, typename word_type>
+void multi_haval<pass_cnt, fpt_len, lanes, word_type>::hash(
+        const void* const* data,
+        const size_type* data_len,
+        void* const* results)
+{
+    multi_haval<pass_cnt, fpt_len, lanes, word_type> context;
+    context.start();
+    context.update(data, data_len);
+    context.end_to(results);
+}
+
+// hash a 32-word block per lane
+template<unsigned int pass_cnt, unsigned int fpt_len, unsigned int lanes, typename word_type>
+void multi_haval<pass_cnt, fpt_len, lanes, word_type>::hash_blocks(const std::uint8_t* const* blocks)
+{
+    detail::lanes_hasher<pass_cnt, word_type>::hash(m_context, blocks, lanes);
+}
+
+// hash many independent messages
+template<unsigned int pass_cnt, unsigned int fpt_len, unsigned int lanes, typename word_type>
+void hash_many(const void* const* data, const std::size_t* data_len, std::size_t count, void* results)
+{
+    using hasher = multi_haval<pass_cnt, fpt_len, lanes, word_type>;
+
+    std::uint8_t* const output = static_cast<std::uint8_t*>(results);
+
+    // order messages by the number of blocks they take once padded,
+    // so that lanes of a group finish at about the same time
+    std::vector<std::pair<std::size_t, std::size_t>> order(count);
+    for (std::size_t i = 0; i < count; i++) {
+        order[i] = std::make_pair((data_len[i] + 10) / 128, i);
+    }
+    std::sort(order.begin(), order.end());
+
+    const void* lane_data[lanes];
+    std::size_t lane_len[lanes];
+    void* lane_results[lanes];
+    std::uint8_t unused_result[hasher::result_size];
+
+    for (std::size_t first = 0; first < count; first += lanes) {
+        const std::size_t group_cnt = std::min<std::size_t>(lanes, count - first);
+
+        // a lone message is not worth a full set of lanes
+        if (group_cnt == 1) {
+            const std::size_t i = order[first].second;
+            haval<pass_cnt, fpt_len> context;
+            context.start();
+            context.update(data[i], data_len[i]);
+            context.end_to(output + i * hasher::result_size);
+            continue;
+        }
+
+        for (unsigned int l = 0; l < lanes; l++) {
+            if (l < group_cnt) {
+                const std::size_t i = order[first + l].second;
+                lane_data[l] = data[i];
+                lane_len[l] = data_len[i];
+                lane_results[l] = output + i * hasher::result_size;
+            } else {
+                lane_data[l] = detail::padding;
+                lane_len[l] = 0;
+                lane_results[l] = unused_result;
+            }
+        }
+
+        hasher::hash(lane_data, lane_len, lane_results);
+    }
+}
+
+} // namespace haval
@@ -35,7 +35,15 @@
 QT_BEGIN_NAMESPACE
 
 class QByteArray;
+class QFileDevice;
 class QIODevice;
+class QString;
+class QThreadPool;
+
+template<typename T>
+class QFuture;
+template<typename T>
+class QFutureInterface;
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 class QByteArrayView;
@@ -59,6 +67,8 @@ public:
 #endif
 
     static constexpr size_type result_size = static_cast<int>(fpt_len) >> 3;
+    static constexpr size_type stream_buffer_size = 64 * 1024;
+    static constexpr size_type async_buffer_size = 1024 * 1024;
 
 public:
     // initialization
@@ -73,15 +83,42 @@ public:
     static QT_PREPEND_NAMESPACE(QByteArray) hash(const void* data, size_type data_len);
     // hash a byte array
     static QT_PREPEND_NAMESPACE(QByteArray) hash(const QT_PREPEND_NAMESPACE(QByteArray)& data);
-    // hash a stream
-    static QT_PREPEND_NAMESPACE(QByteArray) hash(QT_PREPEND_NAMESPACE(QIODevice)* device);
+    // hash a stream, reading it in chunks of buffer_size bytes
+    static QT_PREPEND_NAMESPACE(QByteArray) hash(
+            QT_PREPEND_NAMESPACE(QIODevice)* device, size_type buffer_size = stream_buffer_size);
+    // hash a stream, reading it into a caller-provided buffer
+    static QT_PREPEND_NAMESPACE(QByteArray) hash(
+            QT_PREPEND_NAMESPACE(QIODevice)* device, void* buffer, size_type buffer_size);
+    // hash a file from its current position, straight from a memory mapping where possible and with
+    // async_buffer_size reads otherwise; its length is not limited by size_type
+    static QT_PREPEND_NAMESPACE(QByteArray) hash(QT_PREPEND_NAMESPACE(QFileDevice)* file);
+    // hash a file by path as above, the result is empty if it can't be opened
+    static QT_PREPEND_NAMESPACE(QByteArray) hashFile(const QT_PREPEND_NAMESPACE(QString)& path);
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
     // hash a byte array view
     static QT_PREPEND_NAMESPACE(QByteArray) hash(const QT_PREPEND_NAMESPACE(QByteArrayView)& data);
 #endif
 
+    // hash a stream on a thread pool (the global one if null), reading it in chunks of buffer_size bytes;
+    // the future reports progress in permille of the device size if known, throughput as progress text,
+    // and can be canceled; the device must not be used elsewhere until the future finishes, so files and
+    // buffers are fine but sockets are not; the result is empty if reading fails
+    static QT_PREPEND_NAMESPACE(QFuture)<QT_PREPEND_NAMESPACE(QByteArray)> hashAsync(
+            QT_PREPEND_NAMESPACE(QIODevice)* device,
+            QT_PREPEND_NAMESPACE(QThreadPool)* pool = nullptr,
+            size_type buffer_size = async_buffer_size);
+    // hash a file on a thread pool, opening it there; as above, the result is empty if it can't be read
+    static QT_PREPEND_NAMESPACE(QFuture)<QT_PREPEND_NAMESPACE(QByteArray)> hashFileAsync(
+            const QT_PREPEND_NAMESPACE(QString)& path,
+            QT_PREPEND_NAMESPACE(QThreadPool)* pool = nullptr);
+
 private:
+    static void hashInto(
+            QT_PREPEND_NAMESPACE(QFutureInterface)<QT_PREPEND_NAMESPACE(QByteArray)>& future,
+            QT_PREPEND_NAMESPACE(QIODevice)* device,
+            size_type buffer_size);
+
     impl_type m_impl;
 };
 
@@ -33,18 +33,64 @@
 #include "haval.hpp"
 
 #include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileDevice>
+#include <QFuture>
+#include <QFutureInterface>
 #include <QIODevice>
+#include <QRunnable>
+#include <QString>
+#include <QThreadPool>
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 #include <QByteArrayView>
 #endif
 
 #include <limits>
+#include <memory>
 #include <type_traits>
+#include <utility>
 
 namespace haval
 {
 
+namespace detail
+{
+
+// mapping the whole file at once could exhaust the address space of 32-bit processes
+constexpr qint64 qt_map_window_size = 256 * 1024 * 1024;
+
+// runs a function object on a thread pool
+template<typename function_type>
+class qt_runnable : public QT_PREPEND_NAMESPACE(QRunnable)
+{
+public:
+    explicit qt_runnable(function_type function) :
+        m_function(std::move(function))
+    {
+    }
+
+    void run() override
+    {
+        m_function();
+    }
+
+private:
+    function_type m_function;
+};
+
+template<typename function_type>
+void start_on_pool(QT_PREPEND_NAMESPACE(QThreadPool)* pool, function_type function)
+{
+    if (pool == nullptr) {
+        pool = QT_PREPEND_NAMESPACE(QThreadPool)::globalInstance();
+    }
+    pool->start(new qt_runnable<function_type>(std::move(function)));
+}
+
+} // namespace detail
+
 template<unsigned int pass_cnt, unsigned int fpt_len>
 void QHaval<pass_cnt, fpt_len>::start()
 {
@@ -90,27 +136,184 @@ QT_PREPEND_NAMESPACE(QByteArray) QHaval<pass_cnt, fpt_len>::hash(const QT_PREPEN
 }
 
 template<unsigned int pass_cnt, unsigned int fpt_len>
-QT_PREPEND_NAMESPACE(QByteArray) QHaval<pass_cnt, fpt_len>::hash(QT_PREPEND_NAMESPACE(QIODevice)* device)
+QT_PREPEND_NAMESPACE(QByteArray) QHaval<pass_cnt, fpt_len>::hash(
+        QT_PREPEND_NAMESPACE(QIODevice)* device, size_type buffer_size)
+{
+    Q_ASSERT(buffer_size > 0);
+
+    buffer_size = static_cast<size_type>(detail::block_aligned_size(static_cast<std::size_t>(buffer_size)));
+    const std::unique_ptr<char[]> buffer(new char[buffer_size]);
+
+    return hash(device, buffer.get(), buffer_size);
+}
+
+template<unsigned int pass_cnt, unsigned int fpt_len>
+QT_PREPEND_NAMESPACE(QByteArray) QHaval<pass_cnt, fpt_len>::hash(
+        QT_PREPEND_NAMESPACE(QIODevice)* device, void* buffer, size_type buffer_size)
 {
     Q_ASSERT(device != nullptr);
     Q_ASSERT(device->isReadable());
+    Q_ASSERT(buffer != nullptr);
+    Q_ASSERT(buffer_size > 0);
 
     QHaval<pass_cnt, fpt_len> impl;
     impl.start();
 
-    char buffer[1024];
+    // whole blocks are hashed straight from the buffer
+    char* const chunk = static_cast<char*>(buffer);
+    const auto chunk_size = static_cast<qint64>(detail::block_aligned_size(static_cast<std::size_t>(buffer_size)));
 
     for (;;) {
-        const auto bytes_read = device->read(buffer, sizeof(buffer));
+        const auto bytes_read = device->read(chunk, chunk_size);
         if (bytes_read <= 0) {
             break;
         }
-        impl.update(buffer, static_cast<size_type>(bytes_read));
+        impl.update(chunk, static_cast<size_type>(bytes_read));
     }
 
     return impl.end();
 }
 
+template<unsigned int pass_cnt, unsigned int fpt_len>
+QT_PREPEND_NAMESPACE(QByteArray) QHaval<pass_cnt, fpt_len>::hash(QT_PREPEND_NAMESPACE(QFileDevice)* file)
+{
+    Q_ASSERT(file != nullptr);
+    Q_ASSERT(file->isReadable());
+
+    QHaval<pass_cnt, fpt_len> impl;
+    impl.start();
+
+    const bool sequential = file->isSequential();
+    const qint64 end = sequential ? 0 : file->size();
+    qint64 offset = sequential ? 0 : file->pos();
+
+    // the haval<> instance takes the mapped windows directly, bypassing the int size_type of Qt 5
+    while (offset < end) {
+        const qint64 window_size = qMin(end - offset, detail::qt_map_window_size);
+        uchar* const window = file->map(offset, window_size);
+        if (window == nullptr) {
+            break;
+        }
+        impl.m_impl.update(window, static_cast<typename impl_type::size_type>(window_size));
+        file->unmap(window);
+        offset += window_size;
+    }
+
+    // pipes and files that can't be mapped are read, as is whatever follows the mapped part
+    if (!sequential) {
+        file->seek(offset);
+    }
+    if (sequential || offset < end) {
+        const std::unique_ptr<char[]> chunk(new char[async_buffer_size]);
+        for (;;) {
+            const auto bytes_read = file->read(chunk.get(), async_buffer_size);
+            if (bytes_read <= 0) {
+                break;
+            }
+            impl.update(chunk.get(), static_cast<size_type>(bytes_read));
+        }
+    }
+
+    return impl.end();
+}
+
+template<unsigned int pass_cnt, unsigned int fpt_len>
+QT_PREPEND_NAMESPACE(QByteArray) QHaval<pass_cnt, fpt_len>::hashFile(const QT_PREPEND_NAMESPACE(QString)& path)
+{
+    QT_PREPEND_NAMESPACE(QFile) file(path);
+    if (!file.open(QT_PREPEND_NAMESPACE(QIODevice)::ReadOnly)) {
+        return QT_PREPEND_NAMESPACE(QByteArray)();
+    }
+
+    return hash(&file);
+}
+
+template<unsigned int pass_cnt, unsigned int fpt_len>
+QT_PREPEND_NAMESPACE(QFuture)<QT_PREPEND_NAMESPACE(QByteArray)> QHaval<pass_cnt, fpt_len>::hashAsync(
+        QT_PREPEND_NAMESPACE(QIODevice)* device, QT_PREPEND_NAMESPACE(QThreadPool)* pool, size_type buffer_size)
+{
+    Q_ASSERT(device != nullptr);
+    Q_ASSERT(device->isReadable());
+    Q_ASSERT(buffer_size > 0);
+
+    QT_PREPEND_NAMESPACE(QFutureInterface)<QT_PREPEND_NAMESPACE(QByteArray)> future;
+    future.reportStarted();
+
+    detail::start_on_pool(pool, [future, device, buffer_size]() mutable {
+        hashInto(future, device, buffer_size);
+        future.reportFinished();
+    });
+
+    return future.future();
+}
+
+template<unsigned int pass_cnt, unsigned int fpt_len>
+QT_PREPEND_NAMESPACE(QFuture)<QT_PREPEND_NAMESPACE(QByteArray)> QHaval<pass_cnt, fpt_len>::hashFileAsync(
+        const QT_PREPEND_NAMESPACE(QString)& path, QT_PREPEND_NAMESPACE(QThreadPool)* pool)
+{
+    QT_PREPEND_NAMESPACE(QFutureInterface)<QT_PREPEND_NAMESPACE(QByteArray)> future;
+    future.reportStarted();
+
+    detail::start_on_pool(pool, [future, path]() mutable {
+        QT_PREPEND_NAMESPACE(QFile) file(path);
+        if (file.open(QT_PREPEND_NAMESPACE(QIODevice)::ReadOnly)) {
+            hashInto(future, &file, async_buffer_size);
+        } else {
+            future.reportResult(QT_PREPEND_NAMESPACE(QByteArray)());
+        }
+        future.reportFinished();
+    });
+
+    return future.future();
+}
+
+// the body of a hashing job, stops early once the future is canceled
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void QHaval<pass_cnt, fpt_len>::hashInto(
+        QT_PREPEND_NAMESPACE(QFutureInterface)<QT_PREPEND_NAMESPACE(QByteArray)>& future,
+        QT_PREPEND_NAMESPACE(QIODevice)* device,
+        size_type buffer_size)
+{
+    const qint64 total = device->isSequential() ? 0 : device->size() - device->pos();
+    future.setProgressRange(0, total > 0 ? 1000 : 0);
+
+    const auto chunk_size = static_cast<qint64>(detail::block_aligned_size(static_cast<std::size_t>(buffer_size)));
+    const std::unique_ptr<char[]> chunk(new char[chunk_size]);
+
+    QT_PREPEND_NAMESPACE(QElapsedTimer) timer;
+    timer.start();
+
+    QHaval<pass_cnt, fpt_len> impl;
+    impl.start();
+
+    qint64 done = 0;
+    for (;;) {
+        if (future.isCanceled()) {
+            return;
+        }
+
+        const auto bytes_read = device->read(chunk.get(), chunk_size);
+        if (bytes_read < 0) {
+            future.reportResult(QT_PREPEND_NAMESPACE(QByteArray)());
+            return;
+        }
+        if (bytes_read == 0) {
+            break;
+        }
+        impl.update(chunk.get(), static_cast<size_type>(bytes_read));
+        done += bytes_read;
+
+        // Qt throttles progress notifications itself
+        const qint64 elapsed_ms = timer.elapsed();
+        const double mib_per_second =
+                elapsed_ms > 0 ? static_cast<double>(done) * 1000 / (static_cast<double>(elapsed_ms) * 1024 * 1024) : 0;
+        future.setProgressValueAndText(total > 0 ? static_cast<int>(qMin(done, total) * 1000 / total) : 0,
+                QT_PREPEND_NAMESPACE(QString)::number(mib_per_second, 'f', 1) + QStringLiteral(" MiB/s"));
+    }
+
+    future.reportResult(impl.end());
+}
+
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 
 template<unsigned int pass_cnt, unsigned int fpt_len>
@@ -0,0 +1,99 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "haval.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace haval
+{
+
+// HAVAL-Tree: a separate construction that splits a message into fixed-size leaves, hashes
+// them independently and combines their digests in a left-balanced binary tree; its digests
+// differ from those of plain HAVAL, but leaves can be hashed on several cores at once
+//
+//   leaf = H(0x00 || leaf data)
+//   node = H(0x01 || left || right)
+//   root = H(0x02 || top node || message length || leaf size), both lengths as 64-bit little-endian
+//
+// the left subtree of a node covers the largest power of two leaves that is smaller than
+// the number of leaves below it; an empty message has a single empty leaf
+template<unsigned int pass_cnt, unsigned int fpt_len>
+class tree_haval
+{
+public:
+    using impl_type = haval<pass_cnt, fpt_len>;
+    using size_type = typename impl_type::size_type;
+
+    static constexpr size_type result_size = impl_type::result_size;
+    static constexpr size_type default_leaf_size = 1024 * 1024;
+
+public:
+    explicit tree_haval(size_type leaf_size = default_leaf_size);
+
+    // initialization
+    void start();
+    // updating routine
+    void update(const void* data, size_type data_len);
+    // finalization
+    void end_to(void* data);
+    std::string end();
+
+    // hash a block, using up to thread_cnt threads (0 = one per core)
+    static std::string hash(
+            const void* data,
+            size_type data_len,
+            size_type leaf_size = default_leaf_size,
+            unsigned int thread_cnt = 0);
+    // hash a file, throws std::system_error on failure
+    static std::string hash_file(const char* path, size_type leaf_size = default_leaf_size, unsigned int thread_cnt = 0);
+    // hash the rest of an open file, throws std::system_error on failure
+    static std::string hash_fd(int fd, size_type leaf_size = default_leaf_size, unsigned int thread_cnt = 0);
+
+private:
+    using digest_type = std::array<std::uint8_t, result_size>;
+
+    void start_leaf();
+    void end_leaf();
+    void add_leaf(const digest_type& digest);
+
+private:
+    size_type m_leaf_size;
+    impl_type m_leaf;
+    size_type m_leaf_len;
+    std::uint64_t m_count;
+    std::uint64_t m_leaf_cnt;
+    // roots of complete subtrees, largest first
+    std::vector<digest_type> m_stack;
+};
+
+} // namespace haval
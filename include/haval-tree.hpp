@@ -0,0 +1,296 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "haval-tree.h"
+
+#include "haval.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <thread>
+
+namespace haval
+{
+
+namespace detail
+{
+
+// domain separation prefixes of HAVAL-Tree
+constexpr std::uint8_t tree_leaf = 0x00;
+constexpr std::uint8_t tree_node = 0x01;
+constexpr std::uint8_t tree_root = 0x02;
+
+// write a 64-bit value in little-endian order
+inline void uint64_to_ch(std::uint64_t value, std::uint8_t* string)
+{
+    const word_t words[2] = {static_cast<word_t>(value), static_cast<word_t>(value >> 32)};
+    uint2ch(words, string, 2);
+}
+
+// hash the prefixes, digests and lengths that frame the tree, which are not message bytes
+template<typename hasher_type>
+void update_framing(hasher_type& context, const void* data, std::size_t data_len)
+{
+    context.update(data, data_len);
+    if (stats_enabled) {
+        thread_stats_ref().bytes -= data_len;
+    }
+}
+
+} // namespace detail
+
+template<unsigned int pass_cnt, unsigned int fpt_len>
+tree_haval<pass_cnt, fpt_len>::tree_haval(size_type leaf_size) :
+    m_leaf_size(leaf_size),
+    m_leaf(),
+    m_leaf_len(0),
+    m_count(0),
+    m_leaf_cnt(0),
+    m_stack()
+{
+    assert(leaf_size > 0);
+}
+
+// initialization
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void tree_haval<pass_cnt, fpt_len>::start()
+{
+    m_count = 0;
+    m_leaf_cnt = 0;
+    m_stack.clear();
+    start_leaf();
+}
+
+// hash a string of specified length.
+// to be used in conjunction with start and end_to.
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void tree_haval<pass_cnt, fpt_len>::update(const void* vdata, size_type data_len)
+{
+    const std::uint8_t* data = static_cast<const std::uint8_t*>(vdata);
+
+    m_count += data_len;
+
+    while (data_len > 0) {
+        // a full leaf is only closed once more data arrives, the last one is closed by end_to
+        if (m_leaf_len == m_leaf_size) {
+            end_leaf();
+            start_leaf();
+        }
+
+        const size_type fill_len = std::min(data_len, m_leaf_size - m_leaf_len);
+        m_leaf.update(data, fill_len);
+        m_leaf_len += fill_len;
+        data += fill_len;
+        data_len -= fill_len;
+    }
+}
+
+// finalization
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void tree_haval<pass_cnt, fpt_len>::end_to(void* data)
+{
+    assert(data != nullptr);
+
+    if (m_leaf_cnt == 0 || m_leaf_len > 0) {
+        end_leaf();
+    }
+
+    // fold the remaining subtrees from the right
+    digest_type top = m_stack.back();
+    for (auto it = m_stack.rbegin() + 1; it != m_stack.rend(); ++it) {
+        impl_type node;
+        node.start();
+        detail::update_framing(node, &detail::tree_node, 1);
+        detail::update_framing(node, it->data(), result_size);
+        detail::update_framing(node, top.data(), result_size);
+        node.end_to(top.data());
+    }
+
+    std::uint8_t lengths[16];
+    detail::uint64_to_ch(m_count, &lengths[0]);
+    detail::uint64_to_ch(m_leaf_size, &lengths[8]);
+
+    impl_type root;
+    root.start();
+    detail::update_framing(root, &detail::tree_root, 1);
+    detail::update_framing(root, top.data(), result_size);
+    detail::update_framing(root, lengths, sizeof(lengths));
+    root.end_to(data);
+
+    m_stack.clear();
+    m_leaf_cnt = 0;
+    m_count = 0;
+}
+
+// finalization
+template<unsigned int pass_cnt, unsigned int fpt_len>
+std::string tree_haval<pass_cnt, fpt_len>::end()
+{
+    std::string result(result_size, '\0');
+    end_to(&result[0]);
+    return result;
+}
+
+// hash a block, spreading the leaves over several threads
+template<unsigned int pass_cnt, unsigned int fpt_len>
+std::string tree_haval<pass_cnt, fpt_len>::hash(
+        const void* vdata,
+        size_type data_len,
+        size_type leaf_size,
+        unsigned int thread_cnt)
+{
+    assert(leaf_size > 0);
+
+    const std::uint8_t* const data = static_cast<const std::uint8_t*>(vdata);
+    const size_type leaf_cnt = data_len > 0 ? (data_len - 1) / leaf_size + 1 : 1;
+
+    if (thread_cnt == 0) {
+        thread_cnt = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    if (thread_cnt > leaf_cnt) {
+        thread_cnt = static_cast<unsigned int>(leaf_cnt);
+    }
+
+    // a single thread needs no leaf digest storage
+    if (thread_cnt <= 1) {
+        tree_haval<pass_cnt, fpt_len> context(leaf_size);
+        context.start();
+        context.update(data, data_len);
+        return context.end();
+    }
+
+    std::vector<digest_type> leaves(leaf_cnt);
+    std::atomic<size_type> next_leaf{0};
+
+    const auto worker = [&] {
+        for (;;) {
+            const size_type i = next_leaf.fetch_add(1, std::memory_order_relaxed);
+            if (i >= leaf_cnt) {
+                break;
+            }
+
+            const size_type offset = i * leaf_size;
+            impl_type leaf;
+            leaf.start();
+            detail::update_framing(leaf, &detail::tree_leaf, 1);
+            leaf.update(data + offset, std::min(leaf_size, data_len - offset));
+            leaf.end_to(leaves[i].data());
+        }
+    };
+
+    // counters are per thread, so the workers hand theirs over to the calling thread
+    std::vector<stats> thread_stats_list(thread_cnt - 1);
+    std::vector<std::thread> threads;
+    threads.reserve(thread_cnt - 1);
+    for (unsigned int t = 1; t < thread_cnt; t++) {
+        threads.emplace_back([&worker, &thread_stats_list, t] {
+            worker();
+            thread_stats_list[t - 1] = thread_stats();
+        });
+    }
+    worker();
+    for (unsigned int t = 1; t < thread_cnt; t++) {
+        threads[t - 1].join();
+        detail::thread_stats_ref() += thread_stats_list[t - 1];
+    }
+
+    // combine the leaves the same way as the streaming implementation does
+    tree_haval<pass_cnt, fpt_len> context(leaf_size);
+    context.start();
+    for (const auto& leaf : leaves) {
+        context.add_leaf(leaf);
+    }
+    context.m_leaf_len = 0;
+    context.m_count = data_len;
+    return context.end();
+}
+
+// hash a file
+template<unsigned int pass_cnt, unsigned int fpt_len>
+std::string tree_haval<pass_cnt, fpt_len>::hash_file(const char* path, size_type leaf_size, unsigned int thread_cnt)
+{
+    const detail::fd_guard file{detail::open_file(path)};
+    return hash_fd(file.fd, leaf_size, thread_cnt);
+}
+
+// hash the rest of an open file, in parallel if it can be mapped into memory
+template<unsigned int pass_cnt, unsigned int fpt_len>
+std::string tree_haval<pass_cnt, fpt_len>::hash_fd(int fd, size_type leaf_size, unsigned int thread_cnt)
+{
+    const detail::file_mapping mapping(fd);
+    if (mapping.mapped()) {
+        return hash(mapping.data(), mapping.size(), leaf_size, thread_cnt);
+    }
+
+    tree_haval<pass_cnt, fpt_len> context(leaf_size);
+    context.start();
+    detail::read_from_fd(context, fd);
+    return context.end();
+}
+
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void tree_haval<pass_cnt, fpt_len>::start_leaf()
+{
+    m_leaf.start();
+    detail::update_framing(m_leaf, &detail::tree_leaf, 1);
+    m_leaf_len = 0;
+}
+
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void tree_haval<pass_cnt, fpt_len>::end_leaf()
+{
+    digest_type digest;
+    m_leaf.end_to(digest.data());
+    add_leaf(digest);
+}
+
+// push a leaf and merge every pair of subtrees of equal size
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void tree_haval<pass_cnt, fpt_len>::add_leaf(const digest_type& digest)
+{
+    m_stack.push_back(digest);
+    m_leaf_cnt++;
+
+    for (std::uint64_t merge_cnt = m_leaf_cnt; (merge_cnt & 1) == 0; merge_cnt >>= 1) {
+        const digest_type right = m_stack.back();
+        m_stack.pop_back();
+
+        impl_type node;
+        node.start();
+        detail::update_framing(node, &detail::tree_node, 1);
+        detail::update_framing(node, m_stack.back().data(), result_size);
+        detail::update_framing(node, right.data(), result_size);
+        node.end_to(m_stack.back().data());
+    }
+}
+
+} // namespace haval
@@ -29,6 +29,8 @@
 
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <iosfwd>
 #include <string>
@@ -46,18 +48,48 @@ using word_t = std::uint32_t;
 constexpr word_t version = 1;
 
 struct haval_context {
-    // number of bits in a message
-    word_t count[2];
+    // number of bytes in a message
+    std::uint64_t count;
     // current state of fingerprint
     word_t fingerprint[8];
-    // buffer for a 32-word block
-    word_t block[32];
     // unhashed chars (No.<128)
     std::uint8_t remainder[32 * 4];
 };
 
 } // namespace detail
 
+// whether the hot paths keep count of what they do (HAVAL_ENABLE_STATS)
+#if defined(HAVAL_ENABLE_STATS) || defined(HAVAL_ENABLE_STATS_TIMING)
+constexpr bool stats_enabled = true;
+#else
+constexpr bool stats_enabled = false;
+#endif
+
+// work done by the calling thread since the last reset; always zero unless stats are enabled
+struct stats {
+    // message bytes hashed, not counting the padding and the tail
+    std::uint64_t bytes = 0;
+    // blocks compressed
+    std::uint64_t blocks = 0;
+    // copies into the partial block buffer, and the bytes they moved
+    std::uint64_t staging_copies = 0;
+    std::uint64_t staged_bytes = 0;
+    // digests finalized
+    std::uint64_t finalizations = 0;
+    // reads from streams and files, and those that returned less than asked for
+    std::uint64_t reads = 0;
+    std::uint64_t short_reads = 0;
+    // time stamp counter cycles spent compressing blocks (HAVAL_ENABLE_STATS_TIMING)
+    std::uint64_t block_cycles = 0;
+
+    stats& operator+=(const stats& other);
+};
+
+// counters of the calling thread
+inline stats thread_stats();
+// start counting from zero on the calling thread
+inline void reset_thread_stats();
+
 template<unsigned int pass_cnt, unsigned int fpt_len>
 class haval
 {
@@ -72,6 +104,9 @@ public:
     using size_type = std::size_t;
 
     static constexpr size_type result_size = fpt_len >> 3;
+    static constexpr size_type stream_buffer_size = 64 * 1024;
+
+    using digest_type = std::array<std::uint8_t, result_size>;
 
 public:
     // initialization
@@ -86,11 +121,24 @@ public:
     static std::string hash(const void* data, size_type data_len);
     // hash a string
     static std::string hash(const std::string& data);
-    // hash a stream
-    static std::string hash(std::istream& stream);
+    // hash a stream, reading it in chunks of buffer_size bytes
+    static std::string hash(std::istream& stream, size_type buffer_size = stream_buffer_size);
+    // hash a stream, reading it into a caller-provided buffer
+    static std::string hash(std::istream& stream, void* buffer, size_type buffer_size);
+    // hash a file, throws std::system_error on failure
+    static std::string hash_file(const char* path);
+    // hash the rest of an open file, throws std::system_error on failure
+    static std::string hash_fd(int fd);
+
+    // hash a string literal at compile time, without the terminating null
+    template<std::size_t size>
+    static constexpr digest_type const_hash(const char (&data)[size]);
+    // hash an array at compile time
+    template<typename char_type, std::size_t size>
+    static constexpr digest_type const_hash(const std::array<char_type, size>& data);
 
 private:
-    void hash_block();
+    void hash_block(const std::uint8_t* block);
 
 private:
     detail::haval_context m_context;
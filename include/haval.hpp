@@ -31,14 +31,51 @@
 
 #include "haval.h"
 
+#include <array>
 #include <cassert>
+#include <cerrno>
 #include <cinttypes>
 #include <cstring>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <system_error>
 #include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+
+#if defined(HAVAL_ENABLE_STATS_TIMING) && !defined(HAVAL_ENABLE_STATS)
+#define HAVAL_ENABLE_STATS
+#endif
+
+#ifdef HAVAL_ENABLE_STATS_TIMING
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+#endif
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #define WORD_C UINT32_C
 
+// statements only compiled in with HAVAL_ENABLE_STATS
+#ifdef HAVAL_ENABLE_STATS
+#define HAVAL_STATS(statement) statement
+#else
+#define HAVAL_STATS(statement)
+#endif
+
 namespace haval
 {
 
@@ -56,27 +93,32 @@ constexpr std::uint8_t padding[128] = { //
         0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //
         0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 
-word_t f_1(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0)
+template<typename word_type>
+constexpr word_type f_1(word_type x6, word_type x5, word_type x4, word_type x3, word_type x2, word_type x1, word_type x0)
 {
     return ((x1 & (x0 ^ x4)) ^ (x2 & x5) ^ (x3 & x6) ^ x0);
 }
 
-word_t f_2(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0)
+template<typename word_type>
+constexpr word_type f_2(word_type x6, word_type x5, word_type x4, word_type x3, word_type x2, word_type x1, word_type x0)
 {
     return ((x2 & ((x1 & ~x3) ^ (x4 & x5) ^ x6 ^ x0)) ^ (x4 & (x1 ^ x5)) ^ (x3 & x5) ^ x0);
 }
 
-word_t f_3(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0)
+template<typename word_type>
+constexpr word_type f_3(word_type x6, word_type x5, word_type x4, word_type x3, word_type x2, word_type x1, word_type x0)
 {
     return ((x3 & ((x1 & x2) ^ x6 ^ x0)) ^ (x1 & x4) ^ (x2 & x5) ^ x0);
 }
 
-word_t f_4(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0)
+template<typename word_type>
+constexpr word_type f_4(word_type x6, word_type x5, word_type x4, word_type x3, word_type x2, word_type x1, word_type x0)
 {
     return ((x4 & ((x5 & ~x2) ^ (x3 & ~x6) ^ x1 ^ x6 ^ x0)) ^ (x3 & ((x1 & x2) ^ x5 ^ x6)) ^ (x2 & x6) ^ x0);
 }
 
-word_t f_5(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0)
+template<typename word_type>
+constexpr word_type f_5(word_type x6, word_type x5, word_type x4, word_type x3, word_type x2, word_type x1, word_type x0)
 {
     return ((x0 & ((x1 & x2 & x3) ^ ~x5)) ^ (x1 & x4) ^ (x2 & x5) ^ (x3 & x6));
 }
@@ -109,167 +151,330 @@ word_t f_5(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, wor
 //  phi_{5,5}:   2 5 0 6 4 3 1
 //
 
-template<unsigned int pass_cnt>
-word_t Fphi_1(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0) = delete;
-
-template<>
-word_t Fphi_1<3>(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0)
+template<unsigned int pass_cnt, typename word_type>
+constexpr typename std::enable_if<pass_cnt == 3, word_type>::type Fphi_1(
+        word_type x6,
+        word_type x5,
+        word_type x4,
+        word_type x3,
+        word_type x2,
+        word_type x1,
+        word_type x0)
 {
     return f_1(x1, x0, x3, x5, x6, x2, x4);
 }
 
-template<>
-word_t Fphi_1<4>(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0)
+template<unsigned int pass_cnt, typename word_type>
+constexpr typename std::enable_if<pass_cnt == 4, word_type>::type Fphi_1(
+        word_type x6,
+        word_type x5,
+        word_type x4,
+        word_type x3,
+        word_type x2,
+        word_type x1,
+        word_type x0)
 {
     return f_1(x2, x6, x1, x4, x5, x3, x0);
 }
 
-template<>
-word_t Fphi_1<5>(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0)
+template<unsigned int pass_cnt, typename word_type>
+constexpr typename std::enable_if<pass_cnt == 5, word_type>::type Fphi_1(
+        word_type x6,
+        word_type x5,
+        word_type x4,
+        word_type x3,
+        word_type x2,
+        word_type x1,
+        word_type x0)
 {
     return f_1(x3, x4, x1, x0, x5, x2, x6);
 }
 
-template<unsigned int pass_cnt>
-word_t Fphi_2(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0) = delete;
-
-template<>
-word_t Fphi_2<3>(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0)
+template<unsigned int pass_cnt, typename word_type>
+constexpr typename std::enable_if<pass_cnt == 3, word_type>::type Fphi_2(
+        word_type x6,
+        word_type x5,
+        word_type x4,
+        word_type x3,
+        word_type x2,
+        word_type x1,
+        word_type x0)
 {
     return f_2(x4, x2, x1, x0, x5, x3, x6);
 }
 
-template<>
-word_t Fphi_2<4>(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0)
+template<unsigned int pass_cnt, typename word_type>
+constexpr typename std::enable_if<pass_cnt == 4, word_type>::type Fphi_2(
+        word_type x6,
+        word_type x5,
+        word_type x4,
+        word_type x3,
+        word_type x2,
+        word_type x1,
+        word_type x0)
 {
     return f_2(x3, x5, x2, x0, x1, x6, x4);
 }
 
-template<>
-word_t Fphi_2<5>(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0)
+template<unsigned int pass_cnt, typename word_type>
+constexpr typename std::enable_if<pass_cnt == 5, word_type>::type Fphi_2(
+        word_type x6,
+        word_type x5,
+        word_type x4,
+        word_type x3,
+        word_type x2,
+        word_type x1,
+        word_type x0)
 {
     return f_2(x6, x2, x1, x0, x3, x4, x5);
 }
 
-template<unsigned int pass_cnt>
-word_t Fphi_3(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0) = delete;
-
-template<>
-word_t Fphi_3<3>(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0)
+template<unsigned int pass_cnt, typename word_type>
+constexpr typename std::enable_if<pass_cnt == 3, word_type>::type Fphi_3(
+        word_type x6,
+        word_type x5,
+        word_type x4,
+        word_type x3,
+        word_type x2,
+        word_type x1,
+        word_type x0)
 {
     return f_3(x6, x1, x2, x3, x4, x5, x0);
 }
 
-template<>
-word_t Fphi_3<4>(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0)
+template<unsigned int pass_cnt, typename word_type>
+constexpr typename std::enable_if<pass_cnt == 4, word_type>::type Fphi_3(
+        word_type x6,
+        word_type x5,
+        word_type x4,
+        word_type x3,
+        word_type x2,
+        word_type x1,
+        word_type x0)
 {
     return f_3(x1, x4, x3, x6, x0, x2, x5);
 }
 
-template<>
-word_t Fphi_3<5>(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0)
+template<unsigned int pass_cnt, typename word_type>
+constexpr typename std::enable_if<pass_cnt == 5, word_type>::type Fphi_3(
+        word_type x6,
+        word_type x5,
+        word_type x4,
+        word_type x3,
+        word_type x2,
+        word_type x1,
+        word_type x0)
 {
     return f_3(x2, x6, x0, x4, x3, x1, x5);
 }
 
-template<unsigned int pass_cnt>
-word_t Fphi_4(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0) = delete;
-
-template<>
-word_t Fphi_4<4>(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0)
+template<unsigned int pass_cnt, typename word_type>
+constexpr typename std::enable_if<pass_cnt == 4, word_type>::type Fphi_4(
+        word_type x6,
+        word_type x5,
+        word_type x4,
+        word_type x3,
+        word_type x2,
+        word_type x1,
+        word_type x0)
 {
     return f_4(x6, x4, x0, x5, x2, x1, x3);
 }
 
-template<>
-word_t Fphi_4<5>(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0)
+template<unsigned int pass_cnt, typename word_type>
+constexpr typename std::enable_if<pass_cnt == 5, word_type>::type Fphi_4(
+        word_type x6,
+        word_type x5,
+        word_type x4,
+        word_type x3,
+        word_type x2,
+        word_type x1,
+        word_type x0)
 {
     return f_4(x1, x5, x3, x2, x0, x4, x6);
 }
 
-template<unsigned int pass_cnt>
-word_t Fphi_5(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0) = delete;
-
-template<>
-word_t Fphi_5<5>(word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0)
+template<unsigned int pass_cnt, typename word_type>
+constexpr typename std::enable_if<pass_cnt == 5, word_type>::type Fphi_5(
+        word_type x6,
+        word_type x5,
+        word_type x4,
+        word_type x3,
+        word_type x2,
+        word_type x1,
+        word_type x0)
 {
     return f_5(x2, x5, x0, x6, x4, x3, x1);
 }
 
-word_t rotate_right(word_t x, word_t n)
+template<typename word_type>
+constexpr word_type rotate_right(word_type x, word_t n)
 {
     return ((x >> n) | (x << (32 - n)));
 }
 
-template<unsigned int pass_cnt>
-void FF_1(word_t& x7, word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0, word_t w)
+template<unsigned int pass_cnt, typename word_type>
+constexpr void FF_1(
+        word_type& x7,
+        word_type x6,
+        word_type x5,
+        word_type x4,
+        word_type x3,
+        word_type x2,
+        word_type x1,
+        word_type x0,
+        word_type w)
 {
     x7 = rotate_right(Fphi_1<pass_cnt>(x6, x5, x4, x3, x2, x1, x0), 7) + rotate_right(x7, 11) + w;
 }
 
-template<unsigned int pass_cnt>
-void FF_2(word_t& x7, word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0, word_t w, word_t c)
+template<unsigned int pass_cnt, typename word_type>
+constexpr void FF_2(
+        word_type& x7,
+        word_type x6,
+        word_type x5,
+        word_type x4,
+        word_type x3,
+        word_type x2,
+        word_type x1,
+        word_type x0,
+        word_type w,
+        word_t c)
 {
     x7 = rotate_right(Fphi_2<pass_cnt>(x6, x5, x4, x3, x2, x1, x0), 7) + rotate_right(x7, 11) + w + c;
 }
 
-template<unsigned int pass_cnt>
-void FF_3(word_t& x7, word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0, word_t w, word_t c)
+template<unsigned int pass_cnt, typename word_type>
+constexpr void FF_3(
+        word_type& x7,
+        word_type x6,
+        word_type x5,
+        word_type x4,
+        word_type x3,
+        word_type x2,
+        word_type x1,
+        word_type x0,
+        word_type w,
+        word_t c)
 {
     x7 = rotate_right(Fphi_3<pass_cnt>(x6, x5, x4, x3, x2, x1, x0), 7) + rotate_right(x7, 11) + w + c;
 }
 
-template<unsigned int pass_cnt>
-void FF_4(word_t& x7, word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0, word_t w, word_t c)
+template<unsigned int pass_cnt, typename word_type>
+constexpr void FF_4(
+        word_type& x7,
+        word_type x6,
+        word_type x5,
+        word_type x4,
+        word_type x3,
+        word_type x2,
+        word_type x1,
+        word_type x0,
+        word_type w,
+        word_t c)
 {
     x7 = rotate_right(Fphi_4<pass_cnt>(x6, x5, x4, x3, x2, x1, x0), 7) + rotate_right(x7, 11) + w + c;
 }
 
-template<unsigned int pass_cnt>
-void FF_5(word_t& x7, word_t x6, word_t x5, word_t x4, word_t x3, word_t x2, word_t x1, word_t x0, word_t w, word_t c)
+template<unsigned int pass_cnt, typename word_type>
+constexpr void FF_5(
+        word_type& x7,
+        word_type x6,
+        word_type x5,
+        word_type x4,
+        word_type x3,
+        word_type x2,
+        word_type x1,
+        word_type x0,
+        word_type w,
+        word_t c)
 {
     x7 = rotate_right(Fphi_5<pass_cnt>(x6, x5, x4, x3, x2, x1, x0), 7) + rotate_right(x7, 11) + w + c;
 }
 
-// translate every four characters into a word.
-// assume the number of characters is a multiple of four.
-void ch2uint(const std::uint8_t* string, word_t* word, std::size_t slen)
+// counters of the calling thread
+inline stats& thread_stats_ref()
 {
-    const std::uint8_t* sp = string;
-    word_t* wp = word;
-    while (sp < string + slen) {
-        *wp = word_t{sp[0]} | (word_t{sp[1]} << 8) | (word_t{sp[2]} << 16) | (word_t{sp[3]} << 24);
-        wp++;
-        sp += 4;
-    }
+    thread_local stats counters;
+    return counters;
+}
+
+#ifdef HAVAL_ENABLE_STATS_TIMING
+// time stamp counter, or nanoseconds where there is none
+inline std::uint64_t stats_timestamp()
+{
+#if (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+#endif
+
+// read a little-endian word from memory of any alignment; isa_type only keeps
+// the instantiations made by the ISA-specific kernels apart from the rest
+template<typename isa_type = void>
+inline word_t load_le32(const std::uint8_t* sp)
+{
+#if defined(HAVAL_LITTLE_ENDIAN) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    word_t result;
+    std::memcpy(&result, sp, sizeof(result));
+    return result;
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__ && (defined(__GNUC__) || defined(__clang__))
+    word_t result;
+    std::memcpy(&result, sp, sizeof(result));
+    return __builtin_bswap32(result);
+#else
+    return word_t{sp[0]} | (word_t{sp[1]} << 8) | (word_t{sp[2]} << 16) | (word_t{sp[3]} << 24);
+#endif
+}
+
+// write a word to memory of any alignment in little-endian order
+inline void store_le32(word_t value, std::uint8_t* sp)
+{
+#if defined(HAVAL_LITTLE_ENDIAN) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    std::memcpy(sp, &value, sizeof(value));
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__ && (defined(__GNUC__) || defined(__clang__))
+    value = __builtin_bswap32(value);
+    std::memcpy(sp, &value, sizeof(value));
+#else
+    sp[0] = static_cast<std::uint8_t>(value & 0xFF);
+    sp[1] = static_cast<std::uint8_t>((value >> 8) & 0xFF);
+    sp[2] = static_cast<std::uint8_t>((value >> 16) & 0xFF);
+    sp[3] = static_cast<std::uint8_t>((value >> 24) & 0xFF);
+#endif
 }
 
-// translate each word into four characters
-void uint2ch(const word_t* word, std::uint8_t* string, std::size_t wlen)
+// translate each word into four characters; not constexpr since it goes through store_le32,
+// const_hash builds its digest with fingerprint_bytes instead
+inline void uint2ch(const word_t* word, std::uint8_t* string, std::size_t wlen)
 {
-    const word_t* wp = word;
-    std::uint8_t* sp = string;
-    while (wp < word + wlen) {
-        sp[0] = static_cast<std::uint8_t>(*wp & 0xFF);
-        sp[1] = static_cast<std::uint8_t>((*wp >> 8) & 0xFF);
-        sp[2] = static_cast<std::uint8_t>((*wp >> 16) & 0xFF);
-        sp[3] = static_cast<std::uint8_t>((*wp >> 24) & 0xFF);
-        sp += 4;
-        wp++;
+    for (std::size_t i = 0; i < wlen; i++) {
+        store_le32(word[i], string + i * 4);
     }
 }
 
-template<unsigned int pass_cnt, unsigned int curr_pass = pass_cnt>
-void hash_block(
-        word_t& t0,
-        word_t& t1,
-        word_t& t2,
-        word_t& t3,
-        word_t& t4,
-        word_t& t5,
-        word_t& t6,
-        word_t& t7,
-        const word_t* w,
+// words of a 128-byte block, read straight from memory of any alignment
+struct block_words {
+    word_t operator[](std::size_t i) const
+    {
+        return load_le32(data + i * 4);
+    }
+
+    const std::uint8_t* data;
+};
+
+template<unsigned int pass_cnt, unsigned int curr_pass = pass_cnt, typename word_type, typename block_type>
+constexpr void hash_block(
+        word_type& t0,
+        word_type& t1,
+        word_type& t2,
+        word_type& t3,
+        word_type& t4,
+        word_type& t5,
+        word_type& t6,
+        word_type& t7,
+        const block_type& w,
         typename std::enable_if<curr_pass == 1, int>::type = 0)
 {
     FF_1<pass_cnt>(t7, t6, t5, t4, t3, t2, t1, t0, w[0]);
@@ -309,17 +514,17 @@ void hash_block(
     FF_1<pass_cnt>(t0, t7, t6, t5, t4, t3, t2, t1, w[31]);
 }
 
-template<unsigned int pass_cnt, unsigned int curr_pass = pass_cnt>
-void hash_block(
-        word_t& t0,
-        word_t& t1,
-        word_t& t2,
-        word_t& t3,
-        word_t& t4,
-        word_t& t5,
-        word_t& t6,
-        word_t& t7,
-        const word_t* w,
+template<unsigned int pass_cnt, unsigned int curr_pass = pass_cnt, typename word_type, typename block_type>
+constexpr void hash_block(
+        word_type& t0,
+        word_type& t1,
+        word_type& t2,
+        word_type& t3,
+        word_type& t4,
+        word_type& t5,
+        word_type& t6,
+        word_type& t7,
+        const block_type& w,
         typename std::enable_if<curr_pass == 2, int>::type = 0)
 {
     hash_block<pass_cnt, curr_pass - 1>(t0, t1, t2, t3, t4, t5, t6, t7, w);
@@ -361,17 +566,17 @@ void hash_block(
     FF_2<pass_cnt>(t0, t7, t6, t5, t4, t3, t2, t1, w[27], WORD_C(0xC25A59B5));
 }
 
-template<unsigned int pass_cnt, unsigned int curr_pass = pass_cnt>
-void hash_block(
-        word_t& t0,
-        word_t& t1,
-        word_t& t2,
-        word_t& t3,
-        word_t& t4,
-        word_t& t5,
-        word_t& t6,
-        word_t& t7,
-        const word_t* w,
+template<unsigned int pass_cnt, unsigned int curr_pass = pass_cnt, typename word_type, typename block_type>
+constexpr void hash_block(
+        word_type& t0,
+        word_type& t1,
+        word_type& t2,
+        word_type& t3,
+        word_type& t4,
+        word_type& t5,
+        word_type& t6,
+        word_type& t7,
+        const block_type& w,
         typename std::enable_if<curr_pass == 3, int>::type = 0)
 {
     hash_block<pass_cnt, curr_pass - 1>(t0, t1, t2, t3, t4, t5, t6, t7, w);
@@ -413,17 +618,17 @@ void hash_block(
     FF_3<pass_cnt>(t0, t7, t6, t5, t4, t3, t2, t1, w[2], WORD_C(0x6C24CF5C));
 }
 
-template<unsigned int pass_cnt, unsigned int curr_pass = pass_cnt>
-void hash_block(
-        word_t& t0,
-        word_t& t1,
-        word_t& t2,
-        word_t& t3,
-        word_t& t4,
-        word_t& t5,
-        word_t& t6,
-        word_t& t7,
-        const word_t* w,
+template<unsigned int pass_cnt, unsigned int curr_pass = pass_cnt, typename word_type, typename block_type>
+constexpr void hash_block(
+        word_type& t0,
+        word_type& t1,
+        word_type& t2,
+        word_type& t3,
+        word_type& t4,
+        word_type& t5,
+        word_type& t6,
+        word_type& t7,
+        const block_type& w,
         typename std::enable_if<curr_pass == 4, int>::type = 0)
 {
     hash_block<pass_cnt, curr_pass - 1>(t0, t1, t2, t3, t4, t5, t6, t7, w);
@@ -465,17 +670,17 @@ void hash_block(
     FF_4<pass_cnt>(t0, t7, t6, t5, t4, t3, t2, t1, w[13], WORD_C(0x137A3BE4));
 }
 
-template<unsigned int pass_cnt, unsigned int curr_pass = pass_cnt>
-void hash_block(
-        word_t& t0,
-        word_t& t1,
-        word_t& t2,
-        word_t& t3,
-        word_t& t4,
-        word_t& t5,
-        word_t& t6,
-        word_t& t7,
-        const word_t* w,
+template<unsigned int pass_cnt, unsigned int curr_pass = pass_cnt, typename word_type, typename block_type>
+constexpr void hash_block(
+        word_type& t0,
+        word_type& t1,
+        word_type& t2,
+        word_type& t3,
+        word_type& t4,
+        word_type& t5,
+        word_type& t6,
+        word_type& t7,
+        const block_type& w,
         typename std::enable_if<curr_pass == 5, int>::type = 0)
 {
     hash_block<pass_cnt, curr_pass - 1>(t0, t1, t2, t3, t4, t5, t6, t7, w);
@@ -519,13 +724,11 @@ void hash_block(
 
 // tailor the last output
 template<unsigned int fpt_len>
-void tailor(haval_context& context) = delete;
+void tailor(word_t (&f)[8]) = delete;
 
 template<>
-void tailor<128>(haval_context& context)
+constexpr void tailor<128>(word_t (&f)[8])
 {
-    auto& f = context.fingerprint;
-
     f[0] += rotate_right(
             (f[7] & WORD_C(0x000000FF)) | (f[6] & WORD_C(0xFF000000)) | (f[5] & WORD_C(0x00FF0000)) |
                     (f[4] & WORD_C(0x0000FF00)),
@@ -543,10 +746,8 @@ void tailor<128>(haval_context& context)
 }
 
 template<>
-void tailor<160>(haval_context& context)
+constexpr void tailor<160>(word_t (&f)[8])
 {
-    auto& f = context.fingerprint;
-
     f[0] += rotate_right((f[7] & WORD_C(0x3F)) | (f[6] & (WORD_C(0x7F) << 25)) | (f[5] & (WORD_C(0x3F) << 19)), 19);
     f[1] += rotate_right((f[7] & (WORD_C(0x3F) << 6)) | (f[6] & WORD_C(0x3F)) | (f[5] & (WORD_C(0x7F) << 25)), 25);
     f[2] += (f[7] & (WORD_C(0x7F) << 12)) | (f[6] & (WORD_C(0x3F) << 6)) | (f[5] & WORD_C(0x3F));
@@ -555,10 +756,8 @@ void tailor<160>(haval_context& context)
 }
 
 template<>
-void tailor<192>(haval_context& context)
+constexpr void tailor<192>(word_t (&f)[8])
 {
-    auto& f = context.fingerprint;
-
     f[0] += rotate_right((f[7] & WORD_C(0x1F)) | (f[6] & (WORD_C(0x3F) << 26)), 26);
     f[1] += (f[7] & (WORD_C(0x1F) << 5)) | (f[6] & WORD_C(0x1F));
     f[2] += ((f[7] & (WORD_C(0x3F) << 10)) | (f[6] & (WORD_C(0x1F) << 5))) >> 5;
@@ -568,10 +767,8 @@ void tailor<192>(haval_context& context)
 }
 
 template<>
-void tailor<224>(haval_context& context)
+constexpr void tailor<224>(word_t (&f)[8])
 {
-    auto& f = context.fingerprint;
-
     f[0] += (f[7] >> 27) & 0x1F;
     f[1] += (f[7] >> 22) & 0x1F;
     f[2] += (f[7] >> 18) & 0x0F;
@@ -582,110 +779,472 @@ void tailor<224>(haval_context& context)
 }
 
 template<>
-void tailor<256>(haval_context& /*context*/)
+constexpr void tailor<256>(word_t (& /*f*/)[8])
 {
 }
 
-} // namespace detail
+// tailor for a fingerprint length known only at run time
+inline void tailor(word_t (&f)[8], unsigned int fpt_len)
+{
+    switch (fpt_len) {
+    case 128:
+        tailor<128>(f);
+        break;
+    case 160:
+        tailor<160>(f);
+        break;
+    case 192:
+        tailor<192>(f);
+        break;
+    case 224:
+        tailor<224>(f);
+        break;
+    default:
+        break;
+    }
+}
+
+// initial fingerprint
+constexpr word_t initial_fingerprint[8] = {
+        WORD_C(0x243F6A88),
+        WORD_C(0x85A308D3),
+        WORD_C(0x13198A2E),
+        WORD_C(0x03707344),
+        WORD_C(0xA4093822),
+        WORD_C(0x299F31D0),
+        WORD_C(0x082EFA98),
+        WORD_C(0xEC4E6C89)};
 
 // initialization
-template<unsigned int pass_cnt, unsigned int fpt_len>
-void haval<pass_cnt, fpt_len>::start()
+inline void start(haval_context& context)
 {
     // clear count
-    m_context.count[0] = 0;
-    m_context.count[1] = 0;
+    context.count = 0;
     // initial fingerprint
-    m_context.fingerprint[0] = WORD_C(0x243F6A88);
-    m_context.fingerprint[1] = WORD_C(0x85A308D3);
-    m_context.fingerprint[2] = WORD_C(0x13198A2E);
-    m_context.fingerprint[3] = WORD_C(0x03707344);
-    m_context.fingerprint[4] = WORD_C(0xA4093822);
-    m_context.fingerprint[5] = WORD_C(0x299F31D0);
-    m_context.fingerprint[6] = WORD_C(0x082EFA98);
-    m_context.fingerprint[7] = WORD_C(0xEC4E6C89);
+    std::memcpy(context.fingerprint, initial_fingerprint, sizeof(context.fingerprint));
+}
+
+// save the version number, the number of passes, the fingerprint
+// length and the number of bits in the unpadded message.
+constexpr void make_tail(unsigned int pass_cnt, unsigned int fpt_len, std::uint64_t count, std::uint8_t* tail)
+{
+    tail[0] = static_cast<std::uint8_t>(((fpt_len & 0x3) << 6) | ((pass_cnt & 0x7) << 3) | (version & 0x7));
+    tail[1] = static_cast<std::uint8_t>((fpt_len >> 2) & 0xFF);
+    // the number of bits, 64-bit little-endian
+    for (std::size_t i = 0; i < 8; i++) {
+        tail[2 + i] = static_cast<std::uint8_t>(((count << 3) >> (i * 8)) & 0xFF);
+    }
 }
 
-// hash a string of specified length.
-// to be used in conjunction with haval_start and haval_end.
 template<unsigned int pass_cnt, unsigned int fpt_len>
-void haval<pass_cnt, fpt_len>::update(const void* vdata, size_type data_len)
+constexpr void make_tail(std::uint64_t count, std::uint8_t* tail)
+{
+    make_tail(pass_cnt, fpt_len, count, tail);
+}
+
+// digest bytes of a fingerprint
+template<std::size_t... index>
+constexpr std::array<std::uint8_t, sizeof...(index)> fingerprint_bytes(
+        const word_t* fingerprint,
+        std::index_sequence<index...> /*indices*/)
 {
-    assert(data_len <= UINT32_MAX);
+    return {{static_cast<std::uint8_t>((fingerprint[index / 4] >> (index % 4 * 8)) & 0xFF)...}};
+}
 
-    const std::uint8_t* data = static_cast<const std::uint8_t*>(vdata);
+// hash a message at compile time; data is anything indexable by a constant expression
+template<unsigned int pass_cnt, unsigned int fpt_len, typename input_type>
+constexpr std::array<std::uint8_t, fpt_len / 8> const_hash(const input_type& data, std::size_t data_len)
+{
+    std::uint8_t tail[10] = {};
+    make_tail<pass_cnt, fpt_len>(data_len, tail);
 
-    // calculate the number of bytes in the remainder
-    size_type rmd_len = (m_context.count[0] >> 3) & 0x7F;
-    size_type fill_len = 128 - rmd_len;
+    // the message, the padding and the tail fill a whole number of blocks
+    const std::size_t rmd_len = data_len & 0x7F;
+    const std::size_t total_len = data_len + (rmd_len < 118 ? 118 - rmd_len : 246 - rmd_len) + 10;
 
-    // update the number of bits
-    m_context.count[0] += static_cast<detail::word_t>(data_len) << 3;
-    if (m_context.count[0] < (data_len << 3)) {
-        m_context.count[1]++;
+    word_t fingerprint[8] = {};
+    for (std::size_t i = 0; i < 8; i++) {
+        fingerprint[i] = initial_fingerprint[i];
     }
-    m_context.count[1] += static_cast<detail::word_t>(data_len) >> 29;
 
-    size_type i = 0;
+    for (std::size_t offset = 0; offset < total_len; offset += 128) {
+        word_t w[32] = {};
+        for (std::size_t i = 0; i < 128; i++) {
+            const std::size_t pos = offset + i;
+            const std::uint8_t c = pos < data_len ? static_cast<std::uint8_t>(data[pos]) :
+                    pos < total_len - 10           ? padding[pos - data_len] :
+                                                     tail[pos - (total_len - 10)];
+            w[i / 4] |= word_t{c} << (i % 4 * 8);
+        }
 
-#ifdef HAVAL_LITTLE_ENDIAN
+        word_t t[8] = {};
+        for (std::size_t i = 0; i < 8; i++) {
+            t[i] = fingerprint[i];
+        }
 
-    // hash as many blocks as possible
-    if (rmd_len + data_len >= 128) {
-        std::memcpy(reinterpret_cast<std::uint8_t*>(m_context.block) + rmd_len, data, fill_len);
-        hash_block();
-        for (i = fill_len; i + 127 < data_len; i += 128) {
-            std::memcpy(m_context.block, data + i, 128);
-            hash_block();
+        hash_block<pass_cnt>(t[0], t[1], t[2], t[3], t[4], t[5], t[6], t[7], w);
+
+        for (std::size_t i = 0; i < 8; i++) {
+            fingerprint[i] += t[i];
         }
-        rmd_len = 0;
     }
-    std::memcpy(reinterpret_cast<std::uint8_t*>(m_context.block) + rmd_len, data + i, data_len - i);
 
-#else
+    tailor<fpt_len>(fingerprint);
+
+    return fingerprint_bytes(fingerprint, std::make_index_sequence<fpt_len / 8>());
+}
+
+// hash a 32-word block into a fingerprint
+template<unsigned int pass_cnt>
+void compress(word_t* fingerprint, const std::uint8_t* block)
+{
+    HAVAL_STATS(thread_stats_ref().blocks++);
+#ifdef HAVAL_ENABLE_STATS_TIMING
+    const std::uint64_t start_time = stats_timestamp();
+#endif
+
+    // make use of internal registers
+    auto t0 = fingerprint[0];
+    auto t1 = fingerprint[1];
+    auto t2 = fingerprint[2];
+    auto t3 = fingerprint[3];
+    auto t4 = fingerprint[4];
+    auto t5 = fingerprint[5];
+    auto t6 = fingerprint[6];
+    auto t7 = fingerprint[7];
+
+    hash_block<pass_cnt>(t0, t1, t2, t3, t4, t5, t6, t7, block_words{block});
+
+    fingerprint[0] += t0;
+    fingerprint[1] += t1;
+    fingerprint[2] += t2;
+    fingerprint[3] += t3;
+    fingerprint[4] += t4;
+    fingerprint[5] += t5;
+    fingerprint[6] += t6;
+    fingerprint[7] += t7;
+
+#ifdef HAVAL_ENABLE_STATS_TIMING
+    thread_stats_ref().block_cycles += stats_timestamp() - start_time;
+#endif
+}
+
+// append data to the message, hash_block(block) compresses a single block
+template<typename block_hasher_type>
+void append(haval_context& context, const std::uint8_t* data, std::size_t data_len, block_hasher_type hash_block)
+{
+    // calculate the number of bytes in the remainder
+    std::size_t rmd_len = static_cast<std::size_t>(context.count & 0x7F);
+    std::size_t fill_len = 128 - rmd_len;
+
+    // update the number of bytes
+    context.count += data_len;
+
+    std::size_t i = 0;
 
     // hash as many blocks as possible
     if (rmd_len + data_len >= 128) {
-        std::memcpy(&m_context.remainder[rmd_len], data, fill_len);
-        detail::ch2uint(m_context.remainder, m_context.block, 128);
-        hash_block();
-        for (i = fill_len; i + 127 < data_len; i += 128) {
-            std::memcpy(m_context.remainder, data + i, 128);
-            detail::ch2uint(m_context.remainder, m_context.block, 128);
-            hash_block();
+        // complete the remainder first
+        if (rmd_len != 0) {
+            std::memcpy(&context.remainder[rmd_len], data, fill_len);
+            HAVAL_STATS(thread_stats_ref().staging_copies++);
+            HAVAL_STATS(thread_stats_ref().staged_bytes += fill_len);
+            hash_block(context.remainder);
+            i = fill_len;
+        }
+        // hash the rest straight from the input
+        for (; i + 127 < data_len; i += 128) {
+            hash_block(data + i);
         }
         rmd_len = 0;
     }
     // save the remaining input chars
-    std::memcpy(&m_context.remainder[rmd_len], data + i, data_len - i);
+    std::memcpy(&context.remainder[rmd_len], data + i, data_len - i);
+    HAVAL_STATS(thread_stats_ref().staging_copies += data_len != i ? 1 : 0);
+    HAVAL_STATS(thread_stats_ref().staged_bytes += data_len - i);
+}
 
-#endif
+// hash a string of specified length; only caller data counts as hashed bytes, not the padding and the tail
+template<typename block_hasher_type>
+void update(haval_context& context, const std::uint8_t* data, std::size_t data_len, block_hasher_type hash_block)
+{
+    HAVAL_STATS(thread_stats_ref().bytes += data_len);
+    append(context, data, data_len, hash_block);
 }
 
-// finalization
-template<unsigned int pass_cnt, unsigned int fpt_len>
-void haval<pass_cnt, fpt_len>::end_to(void* data)
+// pad out the message and append the tail, leaving the untailored fingerprint
+template<typename block_hasher_type>
+void pad(haval_context& context, unsigned int pass_cnt, unsigned int fpt_len, block_hasher_type hash_block)
 {
-    assert(data != nullptr);
+    HAVAL_STATS(thread_stats_ref().finalizations++);
 
-    // save the version number, the number of passes, the fingerprint
-    // length and the number of bits in the unpadded message.
     std::uint8_t tail[10];
-    tail[0] = static_cast<std::uint8_t>(((fpt_len & 0x3) << 6) | ((pass_cnt & 0x7) << 3) | (detail::version & 0x7));
-    tail[1] = static_cast<std::uint8_t>((fpt_len >> 2) & 0xFF);
-    detail::uint2ch(m_context.count, &tail[2], 2);
+    make_tail(pass_cnt, fpt_len, context.count, tail);
 
     // pad out to 118 mod 128
-    size_type rmd_len = (m_context.count[0] >> 3) & 0x7f;
-    size_type pad_len = (rmd_len < 118) ? (118 - rmd_len) : (246 - rmd_len);
-    update(detail::padding, pad_len);
+    const std::size_t rmd_len = static_cast<std::size_t>(context.count & 0x7F);
+    const std::size_t pad_len = (rmd_len < 118) ? (118 - rmd_len) : (246 - rmd_len);
+    append(context, padding, pad_len, hash_block);
 
     // append the version number, the number of passes,
     // the fingerprint length and the number of bits
-    update(tail, 10);
+    append(context, tail, 10, hash_block);
+}
+
+// longest message whose padding and tail fit into two blocks
+constexpr std::size_t short_message_size = 245;
+
+// hash a short message in one go, building the padded final block(s) on the stack
+// instead of going through the streaming context
+template<unsigned int pass_cnt, unsigned int fpt_len>
+inline void hash_short(const std::uint8_t* data, std::size_t data_len, std::uint8_t* result)
+{
+    assert(data_len <= short_message_size);
+
+    HAVAL_STATS(thread_stats_ref().bytes += data_len);
+    HAVAL_STATS(thread_stats_ref().staging_copies++);
+    HAVAL_STATS(thread_stats_ref().staged_bytes += data_len);
+    HAVAL_STATS(thread_stats_ref().finalizations++);
+
+    // the message, the padding and the tail fill one block below 118 bytes, two otherwise
+    const std::size_t total_len = data_len < 118 ? 128 : 256;
+
+    std::uint8_t blocks[256];
+    if (data_len != 0) {
+        std::memcpy(blocks, data, data_len);
+    }
+    blocks[data_len] = padding[0];
+    std::memset(&blocks[data_len + 1], 0, total_len - 10 - data_len - 1);
+    make_tail<pass_cnt, fpt_len>(data_len, &blocks[total_len - 10]);
+
+    word_t fingerprint[8];
+    std::memcpy(fingerprint, initial_fingerprint, sizeof(fingerprint));
+
+    for (std::size_t offset = 0; offset < total_len; offset += 128) {
+        compress<pass_cnt>(fingerprint, &blocks[offset]);
+    }
+
+    tailor<fpt_len>(fingerprint);
+
+    uint2ch(fingerprint, result, fpt_len >> 5);
+}
+
+// largest whole number of blocks fitting into a buffer, so that reads keep block alignment
+constexpr std::size_t block_aligned_size(std::size_t size)
+{
+    return size < 128 ? size : size & ~static_cast<std::size_t>(127);
+}
+
+// size of the buffer for files that can't be mapped
+constexpr std::size_t file_buffer_size = 1024 * 1024;
+
+// closes a file descriptor on scope exit
+struct fd_guard {
+    ~fd_guard()
+    {
+#ifdef _WIN32
+        _close(fd);
+#else
+        close(fd);
+#endif
+    }
+
+    int fd;
+};
+
+// read-only mapping of the rest of a regular file, which is then considered consumed;
+// maps nothing if the file is not a regular one or mapping fails
+class file_mapping
+{
+public:
+    explicit file_mapping(int fd)
+    {
+#ifndef _WIN32
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            return;
+        }
+
+        const off_t offset = lseek(fd, 0, SEEK_CUR);
+        if (offset < 0 || offset >= st.st_size ||
+            static_cast<std::uint64_t>(st.st_size) > std::numeric_limits<std::size_t>::max()) {
+            return;
+        }
+
+        // mappings start at a page boundary
+        const off_t map_offset = offset - offset % sysconf(_SC_PAGESIZE);
+        const std::size_t map_len = static_cast<std::size_t>(st.st_size - map_offset);
+        void* const map = mmap(nullptr, map_len, PROT_READ, MAP_PRIVATE, fd, map_offset);
+        if (map == MAP_FAILED) {
+            return;
+        }
+
+        posix_madvise(map, map_len, POSIX_MADV_SEQUENTIAL);
+        lseek(fd, 0, SEEK_END);
+
+        m_map = map;
+        m_map_len = map_len;
+        m_offset = static_cast<std::size_t>(offset - map_offset);
+#else
+        (void)fd;
+#endif
+    }
+
+    file_mapping(const file_mapping&) = delete;
+    file_mapping& operator=(const file_mapping&) = delete;
+
+    ~file_mapping()
+    {
+#ifndef _WIN32
+        if (m_map != nullptr) {
+            munmap(m_map, m_map_len);
+        }
+#endif
+    }
+
+    bool mapped() const
+    {
+        return m_map != nullptr;
+    }
+
+    const std::uint8_t* data() const
+    {
+        return static_cast<const std::uint8_t*>(m_map) + m_offset;
+    }
+
+    std::size_t size() const
+    {
+        return m_map_len - m_offset;
+    }
+
+private:
+    void* m_map = nullptr;
+    std::size_t m_map_len = 0;
+    std::size_t m_offset = 0;
+};
+
+// hash the rest of a file by reading it in large chunks
+template<typename hasher_type>
+void read_from_fd(hasher_type& context, int fd)
+{
+    const std::unique_ptr<std::uint8_t[]> buffer(new std::uint8_t[file_buffer_size]);
+
+    for (;;) {
+#ifdef _WIN32
+        const int bytes_read = _read(fd, buffer.get(), static_cast<unsigned int>(file_buffer_size));
+#else
+        const ssize_t bytes_read = read(fd, buffer.get(), file_buffer_size);
+#endif
+        if (bytes_read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "read");
+        }
+        HAVAL_STATS(thread_stats_ref().reads++);
+        HAVAL_STATS(thread_stats_ref().short_reads += static_cast<std::size_t>(bytes_read) < file_buffer_size ? 1 : 0);
+        if (bytes_read == 0) {
+            break;
+        }
+        context.update(buffer.get(), static_cast<std::size_t>(bytes_read));
+    }
+}
+
+// hash the rest of a stream, reading it into a buffer of chunk_size bytes
+template<typename hasher_type>
+void update_from_stream(hasher_type& context, std::istream& stream, char* chunk, std::streamsize chunk_size)
+{
+    for (;;) {
+        stream.read(chunk, chunk_size);
+        HAVAL_STATS(thread_stats_ref().reads++);
+        HAVAL_STATS(thread_stats_ref().short_reads += stream.gcount() < chunk_size ? 1 : 0);
+        context.update(chunk, static_cast<std::size_t>(stream.gcount()));
+        if (!stream) {
+            break;
+        }
+    }
+}
+
+// hash the rest of a file, mapping it into memory if possible
+template<typename hasher_type>
+void update_from_fd(hasher_type& context, int fd)
+{
+    const file_mapping mapping(fd);
+    if (mapping.mapped()) {
+        context.update(mapping.data(), mapping.size());
+        return;
+    }
+
+    // pipes, devices and such are read in large chunks
+    read_from_fd(context, fd);
+}
+
+// open a file for reading
+inline int open_file(const char* path)
+{
+#ifdef _WIN32
+    const int fd = _open(path, _O_RDONLY | _O_BINARY);
+#else
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+#endif
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), path);
+    }
+    return fd;
+}
+
+} // namespace detail
+
+inline stats& stats::operator+=(const stats& other)
+{
+    bytes += other.bytes;
+    blocks += other.blocks;
+    staging_copies += other.staging_copies;
+    staged_bytes += other.staged_bytes;
+    finalizations += other.finalizations;
+    reads += other.reads;
+    short_reads += other.short_reads;
+    block_cycles += other.block_cycles;
+    return *this;
+}
+
+inline stats thread_stats()
+{
+    return detail::thread_stats_ref();
+}
+
+inline void reset_thread_stats()
+{
+    detail::thread_stats_ref() = stats();
+}
+
+// initialization
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void haval<pass_cnt, fpt_len>::start()
+{
+    detail::start(m_context);
+}
+
+// hash a string of specified length.
+// to be used in conjunction with haval_start and haval_end.
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void haval<pass_cnt, fpt_len>::update(const void* data, size_type data_len)
+{
+    detail::update(m_context, static_cast<const std::uint8_t*>(data), data_len, [this](const std::uint8_t* block) {
+        hash_block(block);
+    });
+}
+
+// finalization
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void haval<pass_cnt, fpt_len>::end_to(void* data)
+{
+    assert(data != nullptr);
+
+    detail::pad(m_context, pass_cnt, fpt_len, [this](const std::uint8_t* block) { hash_block(block); });
 
     // tailor the last output
-    detail::tailor<fpt_len>(m_context);
+    detail::tailor<fpt_len>(m_context.fingerprint);
 
     // translate and save the final fingerprint
     detail::uint2ch(m_context.fingerprint, static_cast<std::uint8_t*>(data), fpt_len >> 5);
@@ -705,34 +1264,22 @@ std::string haval<pass_cnt, fpt_len>::end()
 
 // hash a 32-word block
 template<unsigned int pass_cnt, unsigned int fpt_len>
-void haval<pass_cnt, fpt_len>::hash_block()
+void haval<pass_cnt, fpt_len>::hash_block(const std::uint8_t* block)
 {
-    // make use of internal registers
-    auto t0 = m_context.fingerprint[0];
-    auto t1 = m_context.fingerprint[1];
-    auto t2 = m_context.fingerprint[2];
-    auto t3 = m_context.fingerprint[3];
-    auto t4 = m_context.fingerprint[4];
-    auto t5 = m_context.fingerprint[5];
-    auto t6 = m_context.fingerprint[6];
-    auto t7 = m_context.fingerprint[7];
-
-    detail::hash_block<pass_cnt>(t0, t1, t2, t3, t4, t5, t6, t7, m_context.block);
-
-    m_context.fingerprint[0] += t0;
-    m_context.fingerprint[1] += t1;
-    m_context.fingerprint[2] += t2;
-    m_context.fingerprint[3] += t3;
-    m_context.fingerprint[4] += t4;
-    m_context.fingerprint[5] += t5;
-    m_context.fingerprint[6] += t6;
-    m_context.fingerprint[7] += t7;
+    detail::compress<pass_cnt>(m_context.fingerprint, block);
 }
 
 // hash a block
 template<unsigned int pass_cnt, unsigned int fpt_len>
 std::string haval<pass_cnt, fpt_len>::hash(const void* data, size_type data_len)
 {
+    if (data_len <= detail::short_message_size) {
+        std::string result(result_size, '\0');
+        detail::hash_short<pass_cnt, fpt_len>(
+                static_cast<const std::uint8_t*>(data), data_len, reinterpret_cast<std::uint8_t*>(&result[0]));
+        return result;
+    }
+
     haval<pass_cnt, fpt_len> context;
     context.start();
     context.update(data, data_len);
@@ -746,26 +1293,78 @@ std::string haval<pass_cnt, fpt_len>::hash(const std::string& data)
     return hash(data.data(), data.size());
 }
 
-// hash a stream
+// hash a stream, reading it in chunks of buffer_size bytes
+template<unsigned int pass_cnt, unsigned int fpt_len>
+std::string haval<pass_cnt, fpt_len>::hash(std::istream& stream, size_type buffer_size)
+{
+    assert(buffer_size > 0);
+
+    buffer_size = detail::block_aligned_size(buffer_size);
+    const std::unique_ptr<char[]> buffer(new char[buffer_size]);
+
+    return hash(stream, buffer.get(), buffer_size);
+}
+
+// hash a stream, reading it into a caller-provided buffer
 template<unsigned int pass_cnt, unsigned int fpt_len>
-std::string haval<pass_cnt, fpt_len>::hash(std::istream& stream)
+std::string haval<pass_cnt, fpt_len>::hash(std::istream& stream, void* buffer, size_type buffer_size)
 {
+    assert(buffer != nullptr);
+    assert(buffer_size > 0);
+
     haval<pass_cnt, fpt_len> context;
     context.start();
 
-    char buffer[1024];
+    // whole blocks are hashed straight from the buffer
+    char* const chunk = static_cast<char*>(buffer);
+    const auto chunk_size = static_cast<std::streamsize>(detail::block_aligned_size(buffer_size));
 
-    for (;;) {
-        stream.read(buffer, sizeof(buffer));
-        context.update(buffer, static_cast<size_type>(stream.gcount()));
-        if (stream.eof()) {
-            break;
-        }
-    }
+    detail::update_from_stream(context, stream, chunk, chunk_size);
+    return context.end();
+}
+
+// hash a string literal at compile time
+template<unsigned int pass_cnt, unsigned int fpt_len>
+template<std::size_t size>
+constexpr typename haval<pass_cnt, fpt_len>::digest_type haval<pass_cnt, fpt_len>::const_hash(const char (&data)[size])
+{
+    static_assert(size > 0, "");
+    return detail::const_hash<pass_cnt, fpt_len>(data, size - 1);
+}
+
+// hash an array at compile time
+template<unsigned int pass_cnt, unsigned int fpt_len>
+template<typename char_type, std::size_t size>
+constexpr typename haval<pass_cnt, fpt_len>::digest_type haval<pass_cnt, fpt_len>::const_hash(
+        const std::array<char_type, size>& data)
+{
+    static_assert(sizeof(char_type) == 1, "");
+    return detail::const_hash<pass_cnt, fpt_len>(data, size);
+}
+
+// hash a file
+template<unsigned int pass_cnt, unsigned int fpt_len>
+std::string haval<pass_cnt, fpt_len>::hash_file(const char* path)
+{
+    const detail::fd_guard file{detail::open_file(path)};
+    return hash_fd(file.fd);
+}
 
+// hash the rest of an open file
+template<unsigned int pass_cnt, unsigned int fpt_len>
+std::string haval<pass_cnt, fpt_len>::hash_fd(int fd)
+{
+    haval<pass_cnt, fpt_len> context;
+    context.start();
+    detail::update_from_fd(context, fd);
     return context.end();
 }
 
 } // namespace haval
 
 #undef WORD_C
+#undef HAVAL_STATS
+
+#ifdef HAVAL_EXTERN_TEMPLATES
+#include "haval-extern.h"
+#endif
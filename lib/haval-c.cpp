@@ -0,0 +1,269 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "haval-c.h"
+#include "haval-dispatch.hpp"
+#include "haval.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <new>
+#include <system_error>
+#include <vector>
+
+// functions of one variant, looked up by pass count and fingerprint length
+struct haval_ops {
+    std::size_t digest_size;
+    void (*hash)(const void* data, std::size_t data_len, void* digest);
+    void (*hash_many)(const void* const* data, const std::size_t* data_len, std::size_t count, void* digests);
+    void (*hash_fd)(int fd, void* digest);
+    void* (*create)();
+    void (*update)(void* context, const void* data, std::size_t data_len);
+    void (*final)(void* context, void* digest);
+    void (*destroy)(void* context);
+};
+
+struct haval_state {
+    const haval_ops* ops;
+    void* context;
+};
+
+namespace
+{
+
+template<unsigned int pass_cnt, unsigned int fpt_len>
+struct variant {
+    using hasher = haval::haval<pass_cnt, fpt_len>;
+
+    // writes straight into digest, so unlike hasher::hash it does not allocate
+    static void hash(const void* data, std::size_t data_len, void* digest)
+    {
+        if (data_len <= haval::detail::short_message_size) {
+            haval::detail::hash_short<pass_cnt, fpt_len>(
+                    static_cast<const std::uint8_t*>(data), data_len, static_cast<std::uint8_t*>(digest));
+            return;
+        }
+
+        hasher context;
+        context.start();
+        context.update(data, data_len);
+        context.end_to(digest);
+    }
+
+    static void hash_many(const void* const* data, const std::size_t* data_len, std::size_t count, void* digests)
+    {
+        haval::hash_many<pass_cnt, fpt_len, 16, haval::detail::dispatched_word>(data, data_len, count, digests);
+    }
+
+    static void hash_fd(int fd, void* digest)
+    {
+        hasher context;
+        context.start();
+        haval::detail::update_from_fd(context, fd);
+        context.end_to(digest);
+    }
+
+    static void* create()
+    {
+        hasher* const context = new hasher;
+        context->start();
+        return context;
+    }
+
+    static void update(void* context, const void* data, std::size_t data_len)
+    {
+        static_cast<hasher*>(context)->update(data, data_len);
+    }
+
+    static void final(void* context, void* digest)
+    {
+        static_cast<hasher*>(context)->end_to(digest);
+        static_cast<hasher*>(context)->start();
+    }
+
+    static void destroy(void* context)
+    {
+        delete static_cast<hasher*>(context);
+    }
+
+    static constexpr haval_ops ops = {hasher::result_size, &hash, &hash_many, &hash_fd, &create, &update, &final, &destroy};
+};
+
+template<unsigned int pass_cnt, unsigned int fpt_len>
+constexpr haval_ops variant<pass_cnt, fpt_len>::ops;
+
+const haval_ops* find_ops(unsigned int pass_cnt, unsigned int fpt_len)
+{
+    static const haval_ops* const all_ops[3][5] = {
+            {&variant<3, 128>::ops,
+             &variant<3, 160>::ops,
+             &variant<3, 192>::ops,
+             &variant<3, 224>::ops,
+             &variant<3, 256>::ops},
+            {&variant<4, 128>::ops,
+             &variant<4, 160>::ops,
+             &variant<4, 192>::ops,
+             &variant<4, 224>::ops,
+             &variant<4, 256>::ops},
+            {&variant<5, 128>::ops,
+             &variant<5, 160>::ops,
+             &variant<5, 192>::ops,
+             &variant<5, 224>::ops,
+             &variant<5, 256>::ops},
+    };
+
+    if (pass_cnt < 3 || pass_cnt > 5 || fpt_len < 128 || fpt_len > 256 || fpt_len % 32 != 0) {
+        return nullptr;
+    }
+    return all_ops[pass_cnt - 3][(fpt_len - 128) / 32];
+}
+
+} // namespace
+
+size_t haval_digest_size(unsigned int fpt_len)
+{
+    const haval_ops* const ops = find_ops(3, fpt_len);
+    return ops != nullptr ? ops->digest_size : 0;
+}
+
+int haval_hash(unsigned int pass_cnt, unsigned int fpt_len, const void* data, size_t data_len, void* digest)
+{
+    const haval_ops* const ops = find_ops(pass_cnt, fpt_len);
+    if (ops == nullptr) {
+        return EINVAL;
+    }
+
+    ops->hash(data, data_len, digest);
+    return 0;
+}
+
+int haval_hash_batch(
+        unsigned int pass_cnt,
+        unsigned int fpt_len,
+        const void* const* data,
+        const size_t* data_len,
+        size_t count,
+        void* digests)
+{
+    const haval_ops* const ops = find_ops(pass_cnt, fpt_len);
+    if (ops == nullptr) {
+        return EINVAL;
+    }
+
+    try {
+        ops->hash_many(data, data_len, count, digests);
+    } catch (const std::bad_alloc&) {
+        return ENOMEM;
+    }
+    return 0;
+}
+
+int haval_hash_concat(
+        unsigned int pass_cnt,
+        unsigned int fpt_len,
+        const void* data,
+        const size_t* data_len,
+        size_t count,
+        void* digests)
+{
+    const haval_ops* const ops = find_ops(pass_cnt, fpt_len);
+    if (ops == nullptr) {
+        return EINVAL;
+    }
+
+    try {
+        std::vector<const void*> message_data(count);
+        const auto* message = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < count; i++) {
+            message_data[i] = message;
+            message += data_len[i];
+        }
+
+        ops->hash_many(message_data.data(), data_len, count, digests);
+    } catch (const std::bad_alloc&) {
+        return ENOMEM;
+    }
+    return 0;
+}
+
+int haval_hash_file(unsigned int pass_cnt, unsigned int fpt_len, const char* path, void* digest)
+{
+    const haval_ops* const ops = find_ops(pass_cnt, fpt_len);
+    if (ops == nullptr) {
+        return EINVAL;
+    }
+
+    try {
+        const haval::detail::fd_guard file{haval::detail::open_file(path)};
+        ops->hash_fd(file.fd, digest);
+    } catch (const std::system_error& e) {
+        return e.code().value();
+    } catch (const std::bad_alloc&) {
+        return ENOMEM;
+    }
+    return 0;
+}
+
+haval_state* haval_create(unsigned int pass_cnt, unsigned int fpt_len)
+{
+    const haval_ops* const ops = find_ops(pass_cnt, fpt_len);
+    if (ops == nullptr) {
+        return nullptr;
+    }
+
+    haval_state* const state = new (std::nothrow) haval_state{ops, nullptr};
+    if (state == nullptr) {
+        return nullptr;
+    }
+
+    try {
+        state->context = ops->create();
+    } catch (const std::bad_alloc&) {
+        delete state;
+        return nullptr;
+    }
+    return state;
+}
+
+void haval_update(haval_state* state, const void* data, size_t data_len)
+{
+    state->ops->update(state->context, data, data_len);
+}
+
+void haval_final(haval_state* state, void* digest)
+{
+    state->ops->final(state->context, digest);
+}
+
+void haval_destroy(haval_state* state)
+{
+    if (state != nullptr) {
+        state->ops->destroy(state->context);
+        delete state;
+    }
+}
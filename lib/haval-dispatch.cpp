@@ -0,0 +1,198 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "haval-kernels.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+namespace haval
+{
+
+namespace
+{
+
+constexpr kernel all_kernels[] = {kernel::scalar, kernel::sse2, kernel::avx2, kernel::avx512};
+
+const detail::lane_kernel_type* lane_kernels_of(kernel k)
+{
+    switch (k) {
+    case kernel::scalar:
+    default:
+        return detail::scalar_lane_kernels();
+    case kernel::sse2:
+        return detail::sse2_lane_kernels();
+    case kernel::avx2:
+        return detail::avx2_lane_kernels();
+    case kernel::avx512:
+        return detail::avx512_lane_kernels();
+    }
+}
+
+bool cpu_supports(kernel k)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+    switch (k) {
+    case kernel::scalar:
+        return true;
+    case kernel::sse2:
+        return __builtin_cpu_supports("sse2") != 0;
+    case kernel::avx2:
+        return __builtin_cpu_supports("avx2") != 0;
+    case kernel::avx512:
+        return __builtin_cpu_supports("avx512f") != 0;
+    }
+
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+
+    int regs[4];
+    __cpuid(regs, 0);
+    const int max_leaf = regs[0];
+
+    __cpuid(regs, 1);
+    const bool have_sse2 = (regs[3] & (1 << 26)) != 0;
+    // the OS saves extended registers on context switch
+    const bool have_osxsave = (regs[2] & (1 << 27)) != 0;
+    const unsigned long long xcr0 = have_osxsave ? _xgetbv(0) : 0;
+
+    int ext_ebx = 0;
+    if (max_leaf >= 7) {
+        __cpuidex(regs, 7, 0);
+        ext_ebx = regs[1];
+    }
+
+    switch (k) {
+    case kernel::scalar:
+        return true;
+    case kernel::sse2:
+        return have_sse2;
+    case kernel::avx2:
+        return (xcr0 & 0x06) == 0x06 && (ext_ebx & (1 << 5)) != 0;
+    case kernel::avx512:
+        return (xcr0 & 0xE6) == 0xE6 && (ext_ebx & (1 << 16)) != 0;
+    }
+
+#endif
+
+    return k == kernel::scalar;
+}
+
+kernel best_kernel()
+{
+    kernel result = kernel::scalar;
+    for (kernel k : all_kernels) {
+        if (kernel_supported(k)) {
+            result = k;
+        }
+    }
+    return result;
+}
+
+// HAVAL_KERNEL environment variable pins a kernel, if supported
+kernel initial_kernel()
+{
+    const char* name = std::getenv("HAVAL_KERNEL");
+    if (name != nullptr) {
+        for (kernel k : all_kernels) {
+            if (std::strcmp(name, kernel_name(k)) == 0 && kernel_supported(k)) {
+                return k;
+            }
+        }
+    }
+    return best_kernel();
+}
+
+std::atomic<kernel>& current_kernel()
+{
+    static std::atomic<kernel> value{initial_kernel()};
+    return value;
+}
+
+std::atomic<const detail::lane_kernel_type*>& current_lane_kernels()
+{
+    static std::atomic<const detail::lane_kernel_type*> value{lane_kernels_of(current_kernel().load())};
+    return value;
+}
+
+} // namespace
+
+const char* kernel_name(kernel k)
+{
+    switch (k) {
+    case kernel::scalar:
+    default:
+        return "scalar";
+    case kernel::sse2:
+        return "sse2";
+    case kernel::avx2:
+        return "avx2";
+    case kernel::avx512:
+        return "avx512";
+    }
+}
+
+bool kernel_supported(kernel k)
+{
+    return lane_kernels_of(k) != nullptr && cpu_supports(k);
+}
+
+kernel active_kernel()
+{
+    return current_kernel().load();
+}
+
+bool set_kernel(kernel k)
+{
+    if (!kernel_supported(k)) {
+        return false;
+    }
+
+    current_kernel().store(k);
+    current_lane_kernels().store(lane_kernels_of(k));
+    return true;
+}
+
+namespace detail
+{
+
+lane_kernel_type lane_kernel(unsigned int pass_cnt)
+{
+    assert(pass_cnt >= 3 && pass_cnt <= 5);
+
+    return current_lane_kernels().load(std::memory_order_relaxed)[pass_cnt - 3];
+}
+
+} // namespace detail
+
+} // namespace haval
@@ -0,0 +1,60 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "haval-dispatch.hpp"
+
+namespace haval
+{
+
+namespace detail
+{
+
+// multi-lane kernels for 3, 4 and 5 passes
+template<typename word_type>
+const lane_kernel_type* lane_kernels()
+{
+    static const lane_kernel_type kernels[] = {
+            &lanes_hasher<3, word_type>::hash,
+            &lanes_hasher<4, word_type>::hash,
+            &lanes_hasher<5, word_type>::hash,
+    };
+    return kernels;
+}
+
+// each of these is built with its own instruction set enabled,
+// and returns nullptr if the compiler doesn't support it
+const lane_kernel_type* scalar_lane_kernels();
+const lane_kernel_type* sse2_lane_kernels();
+const lane_kernel_type* avx2_lane_kernels();
+const lane_kernel_type* avx512_lane_kernels();
+
+} // namespace detail
+
+} // namespace haval
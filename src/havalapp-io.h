@@ -0,0 +1,598 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#ifdef HAVAL_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace havalapp
+{
+
+// how file contents reach the hasher
+enum class io_backend {
+    // map the file into memory
+    mmap,
+    // queue reads with io_uring, falling back to pread when it is unavailable
+    uring,
+    // issue reads from a pool of threads
+    pread
+};
+
+#ifndef _WIN32
+
+namespace detail
+{
+
+// alignment of read buffers and of read offsets
+constexpr std::size_t io_alignment = 4096;
+
+// a read in flight or waiting to be consumed
+struct io_slot {
+    std::uint8_t* buffer = nullptr;
+    int fd = -1;
+    std::uint64_t offset = 0;
+    std::size_t size = 0;
+    // bytes read or a negated errno value
+    long result = 0;
+    bool done = false;
+#ifdef HAVAL_HAVE_IO_URING
+    iovec vec = {};
+#endif
+};
+
+// slots whose reads have completed, in completion order
+class io_completions
+{
+public:
+    void push(unsigned int slot)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_slots.push_back(slot);
+        }
+        m_cond.notify_one();
+    }
+
+    unsigned int pop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cond.wait(lock, [this] { return !m_slots.empty(); });
+        const unsigned int slot = m_slots.front();
+        m_slots.pop_front();
+        return slot;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<unsigned int> m_slots;
+};
+
+// threads issuing the reads of all pread pipelines in the process, so that pipelines
+// used by several workers at once share one set of threads
+class pread_pool
+{
+public:
+    static pread_pool& instance();
+
+    pread_pool() = default;
+    ~pread_pool();
+
+    pread_pool(const pread_pool&) = delete;
+    pread_pool& operator=(const pread_pool&) = delete;
+
+    // start threads until there are at least thread_cnt
+    void reserve(unsigned int thread_cnt);
+    // read into a slot and push its index to completions when done
+    void submit(io_slot& slot, unsigned int index, io_completions& completions);
+
+private:
+    struct request {
+        io_slot* slot;
+        unsigned int index;
+        io_completions* completions;
+    };
+
+    void worker();
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<request> m_requests;
+    std::vector<std::thread> m_threads;
+    bool m_stopping = false;
+};
+
+inline pread_pool& pread_pool::instance()
+{
+    static pread_pool pool;
+    return pool;
+}
+
+inline pread_pool::~pread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cond.notify_all();
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+inline void pread_pool::reserve(unsigned int thread_cnt)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    while (m_threads.size() < thread_cnt) {
+        m_threads.emplace_back([this] { worker(); });
+    }
+}
+
+inline void pread_pool::submit(io_slot& slot, unsigned int index, io_completions& completions)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests.push_back(request{&slot, index, &completions});
+    }
+    m_cond.notify_one();
+}
+
+inline void pread_pool::worker()
+{
+    for (;;) {
+        request r;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this] { return m_stopping || !m_requests.empty(); });
+            if (m_requests.empty()) {
+                break;
+            }
+            r = m_requests.front();
+            m_requests.pop_front();
+        }
+
+        io_slot& s = *r.slot;
+        ssize_t bytes_read = 0;
+        do {
+            bytes_read = ::pread(s.fd, s.buffer, s.size, static_cast<off_t>(s.offset));
+        } while (bytes_read < 0 && errno == EINTR);
+
+        // published to the reading thread by the completions lock
+        s.result = bytes_read < 0 ? -errno : static_cast<long>(bytes_read);
+        r.completions->push(r.index);
+    }
+}
+
+} // namespace detail
+
+// reads files block by block with up to depth reads of each file in flight, handing the
+// blocks over in file order; not thread-safe, use one per thread; io_uring pipelines have
+// a ring each, pread pipelines share a process-wide pool of as many threads as the largest
+// depth, so several pipelines together still have at most that many reads in flight
+class read_pipeline
+{
+public:
+    read_pipeline(io_backend backend, unsigned int depth, std::size_t block_size);
+    ~read_pipeline();
+
+    read_pipeline(const read_pipeline&) = delete;
+    read_pipeline& operator=(const read_pipeline&) = delete;
+
+    // backend actually in use
+    io_backend backend() const;
+
+    // read the rest of an open file and call consume(data, size) for each block in file order,
+    // throws std::system_error on failure
+    template<typename consumer_type>
+    void read(int fd, consumer_type&& consume);
+
+private:
+    void submit(unsigned int slot);
+    unsigned int wait_one();
+    void drain(unsigned int& in_flight);
+
+    template<typename consumer_type>
+    void read_sequential(int fd, consumer_type& consume);
+
+#ifdef HAVAL_HAVE_IO_URING
+    bool uring_setup();
+    void uring_teardown();
+    void uring_enter(unsigned int min_complete);
+#endif
+
+private:
+    io_backend m_backend;
+    std::size_t m_block_size;
+    std::uint8_t* m_buffers = nullptr;
+    std::vector<detail::io_slot> m_slots;
+
+#ifdef HAVAL_HAVE_IO_URING
+    int m_ring_fd = -1;
+    void* m_sq_ring = nullptr;
+    std::size_t m_sq_ring_size = 0;
+    void* m_cq_ring = nullptr;
+    std::size_t m_cq_ring_size = 0;
+    io_uring_sqe* m_sqes = nullptr;
+    std::size_t m_sqes_size = 0;
+    unsigned int* m_sq_tail = nullptr;
+    unsigned int m_sq_mask = 0;
+    unsigned int* m_sq_array = nullptr;
+    unsigned int* m_cq_head = nullptr;
+    unsigned int* m_cq_tail = nullptr;
+    unsigned int m_cq_mask = 0;
+    io_uring_cqe* m_cqes = nullptr;
+    unsigned int m_unsubmitted = 0;
+#endif
+
+    // completed reads with the pread backend
+    detail::io_completions m_completions;
+};
+
+inline read_pipeline::read_pipeline(io_backend backend, unsigned int depth, std::size_t block_size) :
+    m_backend(backend),
+    m_block_size((block_size + detail::io_alignment - 1) / detail::io_alignment * detail::io_alignment),
+    m_slots(depth > 0 ? depth : 1)
+{
+    void* buffers = nullptr;
+    if (posix_memalign(&buffers, detail::io_alignment, m_block_size * m_slots.size()) != 0) {
+        throw std::bad_alloc();
+    }
+    m_buffers = static_cast<std::uint8_t*>(buffers);
+    for (std::size_t i = 0; i < m_slots.size(); i++) {
+        m_slots[i].buffer = m_buffers + i * m_block_size;
+    }
+
+    if (m_backend == io_backend::uring) {
+#ifdef HAVAL_HAVE_IO_URING
+        if (!uring_setup()) {
+            m_backend = io_backend::pread;
+        }
+#else
+        m_backend = io_backend::pread;
+#endif
+    }
+
+    if (m_backend == io_backend::pread) {
+        detail::pread_pool::instance().reserve(static_cast<unsigned int>(m_slots.size()));
+    }
+}
+
+inline read_pipeline::~read_pipeline()
+{
+#ifdef HAVAL_HAVE_IO_URING
+    uring_teardown();
+#endif
+
+    std::free(m_buffers);
+}
+
+inline io_backend read_pipeline::backend() const
+{
+    return m_backend;
+}
+
+template<typename consumer_type>
+void read_pipeline::read(int fd, consumer_type&& consume)
+{
+    const off_t start = lseek(fd, 0, SEEK_CUR);
+    if (start < 0 || m_backend == io_backend::mmap) {
+        // pipes and the like can only be read in order
+        read_sequential(fd, consume);
+        return;
+    }
+
+    const auto depth = static_cast<unsigned int>(m_slots.size());
+    std::uint64_t next_offset = static_cast<std::uint64_t>(start);
+    unsigned int in_flight = 0;
+
+    const auto submit_next = [&](unsigned int slot) {
+        m_slots[slot].fd = fd;
+        m_slots[slot].offset = next_offset;
+        m_slots[slot].size = m_block_size;
+        next_offset += m_block_size;
+        submit(slot);
+        in_flight++;
+    };
+
+    for (unsigned int slot = 0; slot < depth; slot++) {
+        submit_next(slot);
+    }
+
+    // slots are reused round-robin, so the oldest read is always at head
+    unsigned int head = 0;
+    int error = 0;
+
+    try {
+        while (in_flight > 0 && error == 0) {
+            while (!m_slots[head].done) {
+                m_slots[wait_one()].done = true;
+            }
+
+            detail::io_slot& slot = m_slots[head];
+            slot.done = false;
+            in_flight--;
+
+            if (slot.result < 0) {
+                if (slot.result == -EINTR || slot.result == -EAGAIN) {
+                    submit(head);
+                    in_flight++;
+                } else {
+                    error = static_cast<int>(-slot.result);
+                }
+                continue;
+            }
+
+            if (slot.result == 0) {
+                // end of file; later reads come back empty as well
+                break;
+            }
+
+            const auto bytes_read = static_cast<std::size_t>(slot.result);
+            consume(static_cast<const void*>(slot.buffer), bytes_read);
+
+            if (bytes_read < slot.size) {
+                // short read, ask for the rest of the block before moving on
+                slot.offset += bytes_read;
+                slot.size -= bytes_read;
+                submit(head);
+                in_flight++;
+            } else {
+                submit_next(head);
+                head = (head + 1) % depth;
+            }
+        }
+    } catch (...) {
+        drain(in_flight);
+        throw;
+    }
+
+    drain(in_flight);
+
+    if (error != 0) {
+        throw std::system_error(error, std::generic_category(), "read");
+    }
+}
+
+template<typename consumer_type>
+void read_pipeline::read_sequential(int fd, consumer_type& consume)
+{
+    for (;;) {
+        const ssize_t bytes_read = ::read(fd, m_buffers, m_block_size);
+        if (bytes_read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "read");
+        }
+        if (bytes_read == 0) {
+            break;
+        }
+        consume(static_cast<const void*>(m_buffers), static_cast<std::size_t>(bytes_read));
+    }
+}
+
+// wait for all reads still in flight, their buffers must not be reused before that
+inline void read_pipeline::drain(unsigned int& in_flight)
+{
+    for (auto& slot : m_slots) {
+        if (slot.done) {
+            slot.done = false;
+            in_flight--;
+        }
+    }
+    while (in_flight > 0) {
+        wait_one();
+        in_flight--;
+    }
+}
+
+inline void read_pipeline::submit(unsigned int slot)
+{
+    detail::io_slot& s = m_slots[slot];
+
+#ifdef HAVAL_HAVE_IO_URING
+    if (m_backend == io_backend::uring) {
+        s.vec.iov_base = s.buffer;
+        s.vec.iov_len = s.size;
+
+        // single producer, the kernel only reads the tail
+        const unsigned int tail = *m_sq_tail;
+        const unsigned int index = tail & m_sq_mask;
+        io_uring_sqe& sqe = m_sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READV;
+        sqe.fd = s.fd;
+        sqe.off = s.offset;
+        sqe.addr = reinterpret_cast<std::uint64_t>(&s.vec);
+        sqe.len = 1;
+        sqe.user_data = slot;
+        m_sq_array[index] = index;
+        __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+        m_unsubmitted++;
+        return;
+    }
+#endif
+
+    detail::pread_pool::instance().submit(s, slot, m_completions);
+}
+
+// wait for any read to complete and return its slot
+inline unsigned int read_pipeline::wait_one()
+{
+#ifdef HAVAL_HAVE_IO_URING
+    if (m_backend == io_backend::uring) {
+        for (;;) {
+            const unsigned int head = *m_cq_head;
+            if (head == __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE)) {
+                uring_enter(1);
+                continue;
+            }
+
+            if (m_unsubmitted > 0) {
+                uring_enter(0);
+            }
+
+            const io_uring_cqe& cqe = m_cqes[head & m_cq_mask];
+            const auto slot = static_cast<unsigned int>(cqe.user_data);
+            m_slots[slot].result = cqe.res;
+            __atomic_store_n(m_cq_head, head + 1, __ATOMIC_RELEASE);
+            return slot;
+        }
+    }
+#endif
+
+    return m_completions.pop();
+}
+
+#ifdef HAVAL_HAVE_IO_URING
+
+// set up a ring with one entry per slot, returns false if the kernel refuses
+inline bool read_pipeline::uring_setup()
+{
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    const long ring_fd = syscall(__NR_io_uring_setup, static_cast<unsigned int>(m_slots.size()), &params);
+    if (ring_fd < 0) {
+        return false;
+    }
+    m_ring_fd = static_cast<int>(ring_fd);
+
+    m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+        m_sq_ring_size = m_cq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+    }
+
+    m_sq_ring = mmap(
+            nullptr, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQ_RING);
+    if (m_sq_ring == MAP_FAILED) {
+        m_sq_ring = nullptr;
+        uring_teardown();
+        return false;
+    }
+
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+        m_cq_ring = m_sq_ring;
+    } else {
+        m_cq_ring = mmap(
+                nullptr, m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_CQ_RING);
+        if (m_cq_ring == MAP_FAILED) {
+            m_cq_ring = nullptr;
+            uring_teardown();
+            return false;
+        }
+    }
+
+    m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void* const sqes =
+            mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        uring_teardown();
+        return false;
+    }
+    m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+    auto* const sq = static_cast<std::uint8_t*>(m_sq_ring);
+    auto* const cq = static_cast<std::uint8_t*>(m_cq_ring);
+    m_sq_tail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+    m_sq_mask = *reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+    m_sq_array = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+    m_cq_head = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+    m_cq_tail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+    m_cq_mask = *reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    return true;
+}
+
+inline void read_pipeline::uring_teardown()
+{
+    if (m_sqes != nullptr) {
+        munmap(m_sqes, m_sqes_size);
+    }
+    if (m_cq_ring != nullptr && m_cq_ring != m_sq_ring) {
+        munmap(m_cq_ring, m_cq_ring_size);
+    }
+    if (m_sq_ring != nullptr) {
+        munmap(m_sq_ring, m_sq_ring_size);
+    }
+    if (m_ring_fd >= 0) {
+        close(m_ring_fd);
+    }
+    m_sqes = nullptr;
+    m_cq_ring = m_sq_ring = nullptr;
+    m_ring_fd = -1;
+}
+
+// submit queued reads and optionally wait for completions
+inline void read_pipeline::uring_enter(unsigned int min_complete)
+{
+    const unsigned int flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    for (;;) {
+        const long submitted = syscall(__NR_io_uring_enter, m_ring_fd, m_unsubmitted, min_complete, flags, nullptr, 0);
+        if (submitted >= 0) {
+            m_unsubmitted -= static_cast<unsigned int>(submitted);
+            return;
+        }
+        if (errno != EINTR) {
+            throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+        }
+    }
+}
+
+#endif
+
+#endif
+
+} // namespace havalapp
@@ -0,0 +1,174 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace havalapp
+{
+
+// number of worker threads to use when asked for "as many as there are cores"
+inline unsigned int default_thread_cnt()
+{
+    const unsigned int thread_cnt = std::thread::hardware_concurrency();
+    return thread_cnt > 0 ? thread_cnt : 1;
+}
+
+// run work(i) for every i in [0, job_cnt) on thread_cnt worker threads and hand
+// each result to report(i, result) on the calling thread, either in index order
+// or as soon as it is ready; idle workers take the next unclaimed job, so slow
+// jobs never hold up the rest of the queue; in index order a job is not started
+// until it is within 4 * thread_cnt of the next one to report, which bounds the
+// results waiting behind a slow one; work must not throw; once report returns
+// false no further jobs are started or reported
+template<typename result_type, typename work_type, typename report_type>
+void run_jobs(std::size_t job_cnt, unsigned int thread_cnt, bool ordered, work_type work, report_type report)
+{
+    if (thread_cnt <= 1 || job_cnt <= 1) {
+        for (std::size_t i = 0; i < job_cnt; i++) {
+            if (!report(i, work(i))) {
+                break;
+            }
+        }
+        return;
+    }
+
+    if (thread_cnt > job_cnt) {
+        thread_cnt = static_cast<unsigned int>(job_cnt);
+    }
+
+    std::atomic<std::size_t> next_job{0};
+    std::atomic<bool> stopped{false};
+    std::mutex finished_mutex;
+    std::condition_variable finished_cond;
+    std::vector<std::pair<std::size_t, result_type>> finished;
+
+    // in index order, jobs at or past report_limit wait for earlier ones to be reported
+    const std::size_t window = 4 * static_cast<std::size_t>(thread_cnt);
+    std::size_t report_limit = window;
+    std::condition_variable limit_cond;
+
+    std::vector<std::thread> workers;
+    workers.reserve(thread_cnt);
+
+    for (unsigned int t = 0; t < thread_cnt; t++) {
+        workers.emplace_back([&] {
+            for (;;) {
+                const std::size_t i = next_job.fetch_add(1, std::memory_order_relaxed);
+                if (i >= job_cnt || stopped.load(std::memory_order_relaxed)) {
+                    break;
+                }
+
+                if (ordered) {
+                    std::unique_lock<std::mutex> lock(finished_mutex);
+                    limit_cond.wait(lock, [&] { return i < report_limit || stopped.load(std::memory_order_relaxed); });
+                    if (stopped.load(std::memory_order_relaxed)) {
+                        break;
+                    }
+                }
+
+                result_type result = work(i);
+
+                {
+                    std::lock_guard<std::mutex> lock(finished_mutex);
+                    finished.emplace_back(i, std::move(result));
+                }
+                finished_cond.notify_one();
+            }
+        });
+    }
+
+    // results that arrived ahead of their turn
+    std::map<std::size_t, result_type> pending;
+    std::vector<std::pair<std::size_t, result_type>> batch;
+    std::size_t next_report = 0;
+    std::size_t reported_cnt = 0;
+
+    const auto report_one = [&](std::size_t i, result_type&& result) {
+        reported_cnt++;
+        if (!report(i, std::move(result))) {
+            stopped = true;
+        }
+    };
+
+    while (reported_cnt < job_cnt && !stopped) {
+        {
+            std::unique_lock<std::mutex> lock(finished_mutex);
+            finished_cond.wait(lock, [&] { return !finished.empty(); });
+            batch.swap(finished);
+        }
+
+        for (auto& item : batch) {
+            if (stopped) {
+                break;
+            }
+
+            if (!ordered) {
+                report_one(item.first, std::move(item.second));
+                continue;
+            }
+
+            pending.emplace(item.first, std::move(item.second));
+            while (!stopped && !pending.empty() && pending.begin()->first == next_report) {
+                report_one(next_report, std::move(pending.begin()->second));
+                pending.erase(pending.begin());
+                next_report++;
+            }
+        }
+
+        batch.clear();
+
+        if (ordered) {
+            {
+                std::lock_guard<std::mutex> lock(finished_mutex);
+                report_limit = next_report + window;
+            }
+            limit_cond.notify_all();
+        }
+    }
+
+    // wake workers waiting for their turn after a stop
+    {
+        std::lock_guard<std::mutex> lock(finished_mutex);
+    }
+    limit_cond.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+} // namespace havalapp
@@ -0,0 +1,170 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+namespace havalapp
+{
+
+// single line of a manifest
+struct manifest_entry {
+    std::string digest;
+    std::string name;
+};
+
+// print a file name the way sha256sum does, returns whether it had to be escaped
+inline bool write_manifest_name(std::ostream& stream, const std::string& name)
+{
+    if (name.find_first_of("\\\n\r") == std::string::npos) {
+        stream << name;
+        return false;
+    }
+
+    for (char c : name) {
+        if (c == '\\') {
+            stream << "\\\\";
+        } else if (c == '\n') {
+            stream << "\\n";
+        } else if (c == '\r') {
+            stream << "\\r";
+        } else {
+            stream << c;
+        }
+    }
+    return true;
+}
+
+// parse "<hex>  <name>" or "<hex> *<name>", with a leading backslash marking an escaped name;
+// the digest is returned in lowercase, returns false if the line is malformed
+inline bool parse_manifest_line(const std::string& line, std::size_t digest_len, manifest_entry& entry)
+{
+    std::size_t pos = 0;
+
+    const bool escaped = !line.empty() && line[0] == '\\';
+    if (escaped) {
+        pos++;
+    }
+
+    if (line.size() < pos + digest_len + 2 || line[pos + digest_len] != ' ' ||
+        (line[pos + digest_len + 1] != ' ' && line[pos + digest_len + 1] != '*')) {
+        return false;
+    }
+
+    entry.digest.clear();
+    for (std::size_t i = pos; i < pos + digest_len; i++) {
+        char c = line[i];
+        if (c >= 'A' && c <= 'F') {
+            c = static_cast<char>(c - 'A' + 'a');
+        } else if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+            return false;
+        }
+        entry.digest += c;
+    }
+
+    pos += digest_len + 2;
+
+    entry.name.clear();
+    for (; pos < line.size(); pos++) {
+        char c = line[pos];
+        if (escaped && c == '\\') {
+            if (++pos == line.size()) {
+                return false;
+            }
+            c = line[pos];
+            if (c == 'n') {
+                c = '\n';
+            } else if (c == 'r') {
+                c = '\r';
+            } else if (c != '\\') {
+                return false;
+            }
+        }
+        entry.name += c;
+    }
+
+    return !entry.name.empty();
+}
+
+// position of a file on disk, used to check files in an order that avoids seeking back and forth;
+// the physical offset of the first extent if requested and supported, the inode number otherwise
+inline std::uint64_t disk_position(const std::string& path, bool by_extent)
+{
+#ifdef _WIN32
+
+    (void)path;
+    (void)by_extent;
+    return 0;
+
+#else
+
+#ifdef __linux__
+    if (by_extent) {
+        const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            // room for the header and a single extent
+            alignas(fiemap) std::uint8_t request[sizeof(fiemap) + sizeof(fiemap_extent)] = {};
+            fiemap* const map = reinterpret_cast<fiemap*>(request);
+            map->fm_length = FIEMAP_MAX_OFFSET;
+            map->fm_extent_count = 1;
+
+            const bool mapped = ioctl(fd, FS_IOC_FIEMAP, map) == 0;
+            close(fd);
+
+            // files without extents have no data to seek to
+            if (mapped) {
+                return map->fm_mapped_extents > 0 ? map->fm_extents[0].fe_physical : 0;
+            }
+        }
+    }
+#else
+    (void)by_extent;
+#endif
+
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? static_cast<std::uint64_t>(st.st_ino) : 0;
+
+#endif
+}
+
+} // namespace havalapp
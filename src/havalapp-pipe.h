@@ -0,0 +1,171 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace havalapp
+{
+
+#ifndef _WIN32
+
+namespace detail
+{
+
+// lets one thread sleep until another changes an atomic it is polling; the mutex is
+// only touched when the waiting side actually has to sleep
+class pipe_waiter
+{
+public:
+    template<typename predicate_type>
+    void wait(predicate_type predicate)
+    {
+        for (int i = 0; i < 64; i++) {
+            if (predicate()) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_sleeping = true;
+        m_cond.wait(lock, predicate);
+        m_sleeping = false;
+    }
+
+    void notify()
+    {
+        if (m_sleeping) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cond.notify_one();
+        }
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::atomic<bool> m_sleeping{false};
+};
+
+} // namespace detail
+
+// read a file descriptor to the end on a separate thread into a ring of buffer_cnt buffers
+// of buffer_size bytes each, calling consume(data, size) on the calling thread for every
+// filled buffer in order; reading and consuming overlap, so a pipe is drained as fast as
+// the slower of the two; consume must not throw; throws std::system_error on read failure
+template<typename consumer_type>
+void read_pipelined(int fd, std::size_t buffer_size, unsigned int buffer_cnt, consumer_type&& consume)
+{
+    const std::unique_ptr<std::uint8_t[]> storage(new std::uint8_t[buffer_size * buffer_cnt]);
+    std::vector<std::size_t> sizes(buffer_cnt);
+
+    // buffers handed over by the reader and given back by the consumer; an empty buffer marks the end
+    std::atomic<std::uint64_t> filled{0};
+    std::atomic<std::uint64_t> consumed{0};
+    detail::pipe_waiter filled_waiter;
+    detail::pipe_waiter consumed_waiter;
+    int error = 0;
+
+    std::thread reader([&] {
+        for (std::uint64_t seq = 0;; seq++) {
+            consumed_waiter.wait([&] { return seq - consumed.load() < buffer_cnt; });
+
+            // fill the whole buffer so the consumer sees large chunks even from a pipe
+            std::uint8_t* const buffer = &storage[(seq % buffer_cnt) * buffer_size];
+            std::size_t size = 0;
+            while (size < buffer_size) {
+                const ssize_t bytes_read = ::read(fd, buffer + size, buffer_size - size);
+                if (bytes_read < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    error = errno;
+                    break;
+                }
+                if (bytes_read == 0) {
+                    break;
+                }
+                size += static_cast<std::size_t>(bytes_read);
+            }
+
+            const bool last = size == 0 || size < buffer_size || error != 0;
+            sizes[seq % buffer_cnt] = size;
+            filled.store(seq + 1);
+            filled_waiter.notify();
+
+            if (last) {
+                if (size != 0) {
+                    // the end marker follows the short buffer
+                    consumed_waiter.wait([&] { return seq + 1 - consumed.load() < buffer_cnt; });
+                    sizes[(seq + 1) % buffer_cnt] = 0;
+                    filled.store(seq + 2);
+                    filled_waiter.notify();
+                }
+                break;
+            }
+        }
+    });
+
+    for (std::uint64_t seq = 0;; seq++) {
+        filled_waiter.wait([&] { return filled.load() > seq; });
+
+        const std::size_t size = sizes[seq % buffer_cnt];
+        if (size == 0) {
+            break;
+        }
+
+        consume(static_cast<const void*>(&storage[(seq % buffer_cnt) * buffer_size]), size);
+
+        consumed.store(seq + 1);
+        consumed_waiter.notify();
+    }
+
+    reader.join();
+
+    if (error != 0) {
+        throw std::system_error(error, std::generic_category(), "read");
+    }
+}
+
+#endif
+
+} // namespace havalapp
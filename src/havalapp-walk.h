@@ -0,0 +1,138 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cerrno>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace havalapp
+{
+
+#ifndef _WIN32
+
+namespace detail
+{
+
+// collect regular files below an open directory; takes ownership of dir_fd
+template<typename error_handler_type>
+void list_files(int dir_fd, const std::string& dir_path, std::vector<std::string>& files, error_handler_type& on_error)
+{
+    DIR* const dir = fdopendir(dir_fd);
+    if (dir == nullptr) {
+        on_error(dir_path, errno);
+        close(dir_fd);
+        return;
+    }
+
+    // descend only after the directory stream and its buffer are released
+    std::vector<std::string> subdirs;
+
+    for (;;) {
+        errno = 0;
+        const dirent* const entry = readdir(dir);
+        if (entry == nullptr) {
+            if (errno != 0) {
+                on_error(dir_path, errno);
+            }
+            break;
+        }
+
+        const char* const name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+            continue;
+        }
+
+        unsigned char type = entry->d_type;
+        if (type == DT_UNKNOWN) {
+            // some file systems don't report the type, ask for it
+            struct stat st;
+            if (fstatat(dirfd(dir), name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                on_error(dir_path + '/' + name, errno);
+                continue;
+            }
+            type = S_ISREG(st.st_mode) ? DT_REG : S_ISDIR(st.st_mode) ? DT_DIR : DT_UNKNOWN;
+        }
+
+        if (type == DT_REG) {
+            files.push_back(dir_path + '/' + name);
+        } else if (type == DT_DIR) {
+            subdirs.emplace_back(name);
+        }
+    }
+
+    const int parent_fd = dup(dirfd(dir));
+    closedir(dir);
+
+    for (const std::string& name : subdirs) {
+        const std::string path = dir_path + '/' + name;
+        const int fd = parent_fd >= 0 ? openat(parent_fd, name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC) : -1;
+        if (fd < 0) {
+            on_error(path, errno);
+            continue;
+        }
+        list_files(fd, path, files, on_error);
+    }
+
+    if (parent_fd >= 0) {
+        close(parent_fd);
+    }
+}
+
+} // namespace detail
+
+// collect regular files below a directory, skipping symbolic links; on_error(path, errno)
+// is called for entries that can't be read, failure to open the root directory throws
+template<typename error_handler_type>
+void list_files(const std::string& root, std::vector<std::string>& files, error_handler_type on_error)
+{
+    const int fd = open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), root);
+    }
+
+    std::string dir_path = root;
+    while (dir_path.size() > 1 && dir_path.back() == '/') {
+        dir_path.pop_back();
+    }
+
+    detail::list_files(fd, dir_path == "/" ? std::string() : dir_path, files, on_error);
+}
+
+#endif
+
+} // namespace havalapp
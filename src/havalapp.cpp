@@ -27,16 +27,31 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include "haval-chunks.hpp"
+#include "haval-dynamic.hpp"
+#include "haval-lengths.hpp"
+#include "haval-tree.hpp"
 #include "haval.hpp"
+#include "havalapp-io.h"
+#include "havalapp-jobs.h"
+#include "havalapp-manifest.h"
+#include "havalapp-pipe.h"
+#include "havalapp-size.h"
+#include "havalapp-walk.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
-
-#include <time.h>
+#include <system_error>
+#include <utility>
+#include <vector>
 
 namespace
 {
@@ -48,49 +63,6 @@ unsigned int get_env_uint(const char* key, unsigned int default_value)
     return int_value > 0 ? static_cast<unsigned int>(int_value) : default_value;
 }
 
-// test the speed of HAVAL
-template<unsigned int pass_cnt, unsigned int fpt_len>
-void haval_speed()
-{
-    const unsigned int blocks_cnt = get_env_uint("HAVAL_NUMBER_OF_BLOCKS", 5000);
-    const unsigned int block_size = get_env_uint("HAVAL_BLOCK_SIZE", 5000);
-
-    std::cout << "Test the speed of HAVAL (PASS = " << pass_cnt << ", FPTLEN = " << fpt_len << " bits)." << std::endl;
-    std::cout << "Hashing " << blocks_cnt << " " << block_size << "-byte blocks ..." << std::endl;
-
-    // initialize test block
-    const std::unique_ptr<std::uint8_t[]> buff(new std::uint8_t[block_size]);
-    for (unsigned int i = 0; i < block_size; i++) {
-        buff[i] = static_cast<std::uint8_t>(~0);
-    }
-
-    haval::haval<pass_cnt, fpt_len> hasher;
-    std::string fingerprint;
-
-    // reset the clock
-    clock();
-
-    // hash
-    hasher.start();
-    for (unsigned int i = 0; i < blocks_cnt; i++) {
-        hasher.update(buff.get(), block_size);
-    }
-    fingerprint = hasher.end();
-
-    // get the number of clocks
-    const clock_t clks = clock();
-    // get cpu time
-    const double cpu_time = static_cast<double>(clks) / static_cast<double>(CLOCKS_PER_SEC);
-
-    if (cpu_time > 0.0) {
-        std::cout << "CPU Time = " << std::fixed << std::setprecision(1) << cpu_time << " seconds" << std::endl;
-        std::cout << "   Speed = " << std::fixed << std::setprecision(2) << ((blocks_cnt * block_size * 8) / (1.0E6 * cpu_time))
-                  << " MBPS (megabits/second)" << std::endl;
-    } else {
-        std::cout << "not enough blocks !" << std::endl;
-    }
-}
-
 // test endianity
 bool little_endian()
 {
@@ -100,10 +72,10 @@ bool little_endian()
 }
 
 // print a fingerprint in hexadecimal
-std::string to_hex(const std::string& fingerprint)
+std::string to_hex(const std::string& fingerprint, bool uppercase = true)
 {
     std::ostringstream stream;
-    stream << std::hex << std::uppercase << std::setfill('0');
+    stream << std::hex << (uppercase ? std::uppercase : std::nouppercase) << std::setfill('0');
     for (char c : fingerprint) {
         stream << std::setw(2) << int{static_cast<std::uint8_t>(c)};
     }
@@ -121,36 +93,677 @@ void usage(unsigned int pass_cnt, unsigned int fpt_len)
               << "Configured to use " << pass_cnt << " passes and a " << fpt_len << "-bit fingerprint length." << std::endl
               << std::endl
               << "    ?/-?/-h    show help menu" << std::endl
+              << "    -c file    check hashes listed in a manifest (- for standard input)" << std::endl
               << "    -e         test endianity" << std::endl
+              << "    -j N       hash up to N files at once (0 = one per core)" << std::endl
               << "    -m string  hash the given string" << std::endl
-              << "    -s         test speed" << std::endl
+              << "    -r dir     hash all files below dir and print a sorted manifest" << std::endl
+              << "    --all      print all 15 pass and length combinations for each file," << std::endl
+              << "               reading it only once" << std::endl
+              << "    --chunks[=min,avg,max]" << std::endl
+              << "               split each file into content-defined chunks of min to max bytes," << std::endl
+              << "               avg on average (default 2K,8K,64K), and print their offsets," << std::endl
+              << "               lengths and hashes" << std::endl
+              << "    --fail-fast" << std::endl
+              << "               with -c, stop at the first mismatch or unreadable file" << std::endl
+              << "    --io=mmap|uring|pread" << std::endl
+              << "               read files by mapping them (default), through io_uring (falling" << std::endl
+              << "               back to pread if unavailable) or from a pool of pread threads" << std::endl
+              << "    --io-depth=N" << std::endl
+              << "               with --io=uring, keep N reads in flight per file; with --io=pread," << std::endl
+              << "               N reads in flight in total, shared by the -j workers (default 8," << std::endl
+              << "               at most 256)" << std::endl
+              << "    --stats    print work counters for each file and in total to standard error" << std::endl
+              << "               (needs a build with HAVAL_ENABLE_STATS)" << std::endl
+              << "    --tree[=size]" << std::endl
+              << "               use HAVAL-Tree with leaves of size bytes (default 1M), hashing" << std::endl
+              << "               each file with -j threads (default one per core)" << std::endl
+              << "    --order=inode|extent" << std::endl
+              << "               with -c, check files in on-disk order instead of manifest order" << std::endl
+              << "    --unordered" << std::endl
+              << "               with -j, print results as they complete" << std::endl
               << std::endl
               << "Report bugs to <info@calyptix.com>." << std::endl;
 }
 
+// parse "min,avg,max" chunk sizes
+bool parse_chunk_sizes(const std::string& text, haval::chunk_sizes& sizes)
+{
+    const std::size_t first_comma = text.find(',');
+    const std::size_t second_comma = first_comma != std::string::npos ? text.find(',', first_comma + 1) : first_comma;
+    if (second_comma == std::string::npos) {
+        return false;
+    }
+
+    return havalapp::parse_size(text.substr(0, first_comma), sizes.min) &&
+           havalapp::parse_size(text.substr(first_comma + 1, second_comma - first_comma - 1), sizes.avg) &&
+           havalapp::parse_size(text.substr(second_comma + 1), sizes.max) && sizes.min > 0 && sizes.min <= sizes.avg &&
+           sizes.avg <= sizes.max && sizes.avg >= 64;
+}
+
+// order in which manifest entries are checked
+enum class check_order {
+    manifest,
+    inode,
+    extent
+};
+
+// options that apply to all files on the command line
+struct options {
+    unsigned int pass_cnt = 3;
+    unsigned int fpt_len = 256;
+    unsigned int thread_cnt = 1;
+    bool thread_cnt_set = false;
+    bool ordered = true;
+    std::size_t tree_leaf_size = 0;
+    bool fail_fast = false;
+    check_order order = check_order::manifest;
+    havalapp::io_backend io = havalapp::io_backend::mmap;
+    unsigned int io_depth = 8;
+    bool all = false;
+    bool chunks = false;
+    haval::chunk_sizes chunk_sizes;
+    bool stats = false;
+};
+
+// hash result of a single file
+struct file_result {
+    std::string digest;
+    // with --all
+    haval::all_variants::digests_type all_digests;
+    // with --chunks, those not printed while the file was read
+    std::vector<haval::chunk_record> chunks;
+    // why the file could not be opened or read, if it could not
+    std::error_code error;
+    // with --stats, counters of the hashing thread
+    haval::stats stats;
+};
+
+// with --stats, counters summed over everything hashed so far
+haval::stats total_stats;
+
+// print counters to standard error and add them to the total
+void report_stats(const std::string& name, const haval::stats& stats, const options& opts)
+{
+    if (!opts.stats) {
+        return;
+    }
+
+    std::cerr << "stats(" << name << "): bytes=" << stats.bytes << " blocks=" << stats.blocks
+              << " staging_copies=" << stats.staging_copies << " staged_bytes=" << stats.staged_bytes
+              << " finalizations=" << stats.finalizations << " reads=" << stats.reads
+              << " short_reads=" << stats.short_reads;
+    if (stats.block_cycles > 0 && stats.blocks > 0) {
+        std::cerr << " cycles_per_block=" << stats.block_cycles / stats.blocks
+                  << " cycles_per_byte=" << std::fixed << std::setprecision(2)
+                  << static_cast<double>(stats.block_cycles) / static_cast<double>(stats.blocks * 128)
+                  << std::defaultfloat;
+    }
+    std::cerr << std::endl;
+
+    if (&stats != &total_stats) {
+        total_stats += stats;
+    }
+}
+
+// number of files hashed at once; in tree mode threads work on the leaves of one file instead
+unsigned int file_thread_cnt(const options& opts)
+{
+    return opts.tree_leaf_size > 0 ? 1 : opts.thread_cnt;
+}
+
+// HAVAL-Tree digest of a file, or of standard input if path is null
 template<unsigned int pass_cnt, unsigned int fpt_len>
-int main_impl(int argc, char* argv[])
+std::string tree_hash(const char* path, const options& opts)
 {
-    using hasher = haval::haval<pass_cnt, fpt_len>;
+    using hasher = haval::tree_haval<pass_cnt, fpt_len>;
+    return path != nullptr ? hasher::hash_file(path, opts.tree_leaf_size, opts.thread_cnt) :
+                             hasher::hash_fd(0, opts.tree_leaf_size, opts.thread_cnt);
+}
 
-    if (argc <= 1) {
-        // filter
-        std::cout << to_hex(hasher::hash(std::cin)) << std::endl;
+// tree mode is the only one still needing a template per variant
+std::string tree_hash(const char* path, const options& opts)
+{
+    using tree_hash_function = std::string (*)(const char* path, const options& opts);
+
+    static const tree_hash_function functions[3][5] = {
+            {&tree_hash<3, 128>, &tree_hash<3, 160>, &tree_hash<3, 192>, &tree_hash<3, 224>, &tree_hash<3, 256>},
+            {&tree_hash<4, 128>, &tree_hash<4, 160>, &tree_hash<4, 192>, &tree_hash<4, 224>, &tree_hash<4, 256>},
+            {&tree_hash<5, 128>, &tree_hash<5, 160>, &tree_hash<5, 192>, &tree_hash<5, 224>, &tree_hash<5, 256>},
+    };
+
+    return functions[opts.pass_cnt - 3][(opts.fpt_len - 128) / 32](path, opts);
+}
+
+// feed a file to a started hasher using the configured I/O method
+template<typename hasher_type>
+void read_file(hasher_type& context, const std::string& path, const options& opts)
+{
+    const haval::detail::fd_guard file{haval::detail::open_file(path.c_str())};
+
+#ifndef _WIN32
+    if (opts.io != havalapp::io_backend::mmap) {
+        // one pipeline per worker thread, reused for every file it hashes
+        thread_local havalapp::read_pipeline pipeline(opts.io, opts.io_depth, haval::detail::file_buffer_size);
+        pipeline.read(file.fd, [&](const void* data, std::size_t size) { context.update(data, size); });
+        return;
+    }
+#else
+    (void)opts;
+#endif
+
+    haval::detail::update_from_fd(context, file.fd);
+}
+
+// feed standard input to a started hasher, returns false if it can not be read
+template<typename hasher_type>
+bool read_stdin(hasher_type& context)
+{
+#ifdef _WIN32
+    const std::unique_ptr<char[]> buffer(new char[haval::detail::file_buffer_size]);
+    haval::detail::update_from_stream(
+            context, std::cin, buffer.get(), static_cast<std::streamsize>(haval::detail::file_buffer_size));
+#else
+    // read on a separate thread so that the producer is not held up while we hash
+    try {
+        havalapp::read_pipelined(0, haval::detail::file_buffer_size, 4, [&](const void* data, std::size_t size) {
+            context.update(data, size);
+        });
+    } catch (const std::system_error& e) {
+        std::cerr << "standard input can not be read: " << e.code().message() << std::endl;
+        return false;
+    }
+#endif
+    return true;
+}
+
+// gives a chunker the update() that read_file and read_stdin feed
+template<typename consume_type>
+struct chunk_feeder {
+    haval::chunker<haval::dynamic_haval>& chunker;
+    consume_type consume;
+
+    void update(const void* data, std::size_t size)
+    {
+        chunker.update(data, size, consume);
+    }
+};
+
+template<typename consume_type>
+chunk_feeder<consume_type> make_chunk_feeder(haval::chunker<haval::dynamic_haval>& chunker, consume_type consume)
+{
+    return chunk_feeder<consume_type>{chunker, std::move(consume)};
+}
+
+// print a chunk as HAVAL(<name>, <offset>, <length>) = <hash>
+void print_chunk(const std::string& name, const haval::chunk_record& chunk)
+{
+    std::cout << "HAVAL(" << name << ", " << chunk.offset << ", " << chunk.length << ") = " << to_hex(chunk.digest)
+              << '\n';
+}
+
+// with --chunks, lets files print their chunks while they are being read; in ordered output
+// only the file whose turn it is does, and the others keep theirs until they are reported
+class chunk_printer
+{
+public:
+    explicit chunk_printer(bool ordered) :
+        m_ordered(ordered)
+    {
+    }
+
+    // print a chunk of file i now if possible, add it to pending otherwise
+    void add(std::size_t i, const std::string& name, haval::chunk_record&& chunk,
+            std::vector<haval::chunk_record>& pending)
+    {
+        if (!m_ordered) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            print_chunk(name, chunk);
+            return;
+        }
+
+        // the reporting thread hands the turn over only after printing everything before it
+        if (m_turn.load(std::memory_order_acquire) != i) {
+            pending.push_back(std::move(chunk));
+            return;
+        }
+        for (const auto& pending_chunk : pending) {
+            print_chunk(name, pending_chunk);
+        }
+        pending.clear();
+        print_chunk(name, chunk);
     }
 
+    // on the reporting thread once file i is done: print what it kept, or that it failed,
+    // and pass the turn to the next file
+    void finish(std::size_t i, const std::string& name, const file_result& result)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& chunk : result.chunks) {
+            print_chunk(name, chunk);
+        }
+        if (result.error) {
+            std::cout << name << ": " << result.error.message() << '\n';
+        }
+        std::cout.flush();
+        m_turn.store(i + 1, std::memory_order_release);
+    }
+
+private:
+    bool m_ordered;
+    std::atomic<std::size_t> m_turn{0};
+    std::mutex m_mutex;
+};
+
+// hash a single file, the index-th one of those handed to printer with --chunks
+file_result hash_file(
+        const std::string& path, const options& opts, chunk_printer* printer = nullptr, std::size_t index = 0)
+{
+    file_result result;
+    haval::reset_thread_stats();
+    try {
+        if (opts.tree_leaf_size > 0) {
+            result.digest = tree_hash(path.c_str(), opts);
+        } else if (opts.all) {
+            haval::all_variants context;
+            context.start();
+            read_file(context, path, opts);
+            result.all_digests = context.end();
+        } else if (opts.chunks) {
+            haval::chunker<haval::dynamic_haval> chunker(opts.chunk_sizes, {opts.pass_cnt, opts.fpt_len});
+            chunker.start();
+            auto feeder = make_chunk_feeder(chunker, [&](haval::chunk_record&& chunk) {
+                printer->add(index, path, std::move(chunk), result.chunks);
+            });
+            read_file(feeder, path, opts);
+            chunker.end(feeder.consume);
+        } else {
+            haval::dynamic_haval context(opts.pass_cnt, opts.fpt_len);
+            context.start();
+            read_file(context, path, opts);
+            result.digest = context.end();
+        }
+    } catch (const std::system_error& e) {
+        result.error = e.code();
+    }
+    result.stats = haval::thread_stats();
+    return result;
+}
+
+// print the digests of all 15 variants, labelled HAVAL-<passes>-<bits>
+void print_all(const std::string& name, const haval::all_variants::digests_type& digests)
+{
+    for (std::size_t p = 0; p < digests.size(); p++) {
+        for (std::size_t l = 0; l < digests[p].size(); l++) {
+            std::cout << "HAVAL-" << p + 3 << "-" << haval::multi_length<3>::fpt_len(l) << "(" << name
+                      << ") = " << to_hex(digests[p][l]) << '\n';
+        }
+    }
+    std::cout.flush();
+}
+
+// hash a list of files, possibly in parallel, and print the results
+void hash_files(const std::vector<std::string>& files, const options& opts)
+{
+    chunk_printer printer(opts.ordered);
+
+    havalapp::run_jobs<file_result>(
+            files.size(), file_thread_cnt(opts), opts.ordered,
+            [&](std::size_t i) { return hash_file(files[i], opts, &printer, i); },
+            [&](std::size_t i, file_result&& result) {
+                report_stats(files[i], result.stats, opts);
+                if (opts.chunks) {
+                    printer.finish(i, files[i], result);
+                } else if (result.error) {
+                    std::cout << files[i] << ": " << result.error.message() << std::endl;
+                } else if (opts.all) {
+                    print_all(files[i], result.all_digests);
+                } else {
+                    std::cout << (opts.tree_leaf_size > 0 ? "HAVAL-TREE(" : "HAVAL(") << files[i]
+                              << ") = " << to_hex(result.digest) << std::endl;
+                }
+                return true;
+            });
+}
+
+// hash all files below a directory and print a manifest sorted by path, returns false on errors
+bool hash_tree(const std::string& root, const options& opts)
+{
+#ifdef _WIN32
+
+    (void)opts;
+    std::cerr << root << ": directory hashing is not supported on this platform" << std::endl;
+    return false;
+
+#else
+
+    bool ok = true;
+    std::vector<std::string> files;
+
+    try {
+        havalapp::list_files(root, files, [&](const std::string& path, int error) {
+            std::cerr << path << ": " << std::generic_category().message(error) << std::endl;
+            ok = false;
+        });
+    } catch (const std::system_error& e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+
+    std::sort(files.begin(), files.end());
+
+    havalapp::run_jobs<file_result>(
+            files.size(), file_thread_cnt(opts), true,
+            [&](std::size_t i) { return hash_file(files[i], opts); },
+            [&](std::size_t i, file_result&& result) {
+                report_stats(files[i], result.stats, opts);
+                if (result.error) {
+                    std::cerr << files[i] << ": " << result.error.message() << std::endl;
+                    ok = false;
+                    return true;
+                }
+
+                // "<hash>  <name>", with a leading backslash if the name is escaped
+                std::ostringstream line;
+                const bool escaped = havalapp::write_manifest_name(line, files[i]);
+                std::cout << (escaped ? "\\" : "") << to_hex(result.digest, false) << "  " << line.str() << '\n';
+                return true;
+            });
+
+    std::cout.flush();
+
+    return ok;
+
+#endif
+}
+
+// a file name escaped as in a manifest, with a leading backslash if it had to be
+std::string escape_name(const std::string& name)
+{
+    std::ostringstream line;
+    const bool escaped = havalapp::write_manifest_name(line, name);
+    return (escaped ? "\\" : "") + line.str();
+}
+
+// print "<name>: <status>" for a checked file
+void print_check_line(const std::string& name, const char* status)
+{
+    std::cout << escape_name(name) << ": " << status << '\n';
+}
+
+// check the files listed in a manifest and print the outcome for each, returns false on errors
+bool check_manifest(const std::string& manifest, const options& opts)
+{
+    std::ifstream file;
+    if (manifest != "-") {
+        file.open(manifest.c_str(), std::ios::in | std::ios::binary);
+        if (!file.good()) {
+            std::cerr << manifest << " can not be opened !" << std::endl;
+            return false;
+        }
+    }
+
+    std::istream& stream = manifest != "-" ? file : std::cin;
+
+    std::vector<havalapp::manifest_entry> entries;
+    std::size_t malformed_cnt = 0;
+
+    for (std::string line; std::getline(stream, line);) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        havalapp::manifest_entry entry;
+        if (havalapp::parse_manifest_line(line, opts.fpt_len / 4, entry)) {
+            entries.push_back(std::move(entry));
+        } else if (!line.empty()) {
+            malformed_cnt++;
+        }
+    }
+
+    if (opts.order != check_order::manifest) {
+        std::vector<std::pair<std::uint64_t, havalapp::manifest_entry>> positioned;
+        positioned.reserve(entries.size());
+        for (auto& entry : entries) {
+            const std::uint64_t position = havalapp::disk_position(entry.name, opts.order == check_order::extent);
+            positioned.emplace_back(position, std::move(entry));
+        }
+
+        std::stable_sort(positioned.begin(), positioned.end(),
+                [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+        for (std::size_t i = 0; i < entries.size(); i++) {
+            entries[i] = std::move(positioned[i].second);
+        }
+    }
+
+    std::size_t mismatch_cnt = 0;
+    std::size_t unreadable_cnt = 0;
+
+    havalapp::run_jobs<file_result>(
+            entries.size(), file_thread_cnt(opts), opts.ordered,
+            [&](std::size_t i) { return hash_file(entries[i].name, opts); },
+            [&](std::size_t i, file_result&& result) {
+                const havalapp::manifest_entry& entry = entries[i];
+                report_stats(entry.name, result.stats, opts);
+                if (result.error) {
+                    std::cerr << escape_name(entry.name) << ": " << result.error.message() << std::endl;
+                    print_check_line(entry.name, "FAILED open or read");
+                    std::cout.flush();
+                    unreadable_cnt++;
+                } else if (to_hex(result.digest, false) != entry.digest) {
+                    print_check_line(entry.name, "FAILED");
+                    std::cout.flush();
+                    mismatch_cnt++;
+                } else {
+                    print_check_line(entry.name, "OK");
+                }
+                return !opts.fail_fast || (unreadable_cnt == 0 && mismatch_cnt == 0);
+            });
+
+    std::cout.flush();
+
+    if (malformed_cnt > 0) {
+        std::cerr << "WARNING: " << malformed_cnt << " line(s) are improperly formatted" << std::endl;
+    }
+    if (unreadable_cnt > 0) {
+        std::cerr << "WARNING: " << unreadable_cnt << " listed file(s) could not be read" << std::endl;
+    }
+    if (mismatch_cnt > 0) {
+        std::cerr << "WARNING: " << mismatch_cnt << " computed checksum(s) did NOT match" << std::endl;
+    }
+
+    return entries.size() > 0 && malformed_cnt == 0 && unreadable_cnt == 0 && mismatch_cnt == 0;
+}
+
+int main_impl(unsigned int pass_cnt, unsigned int fpt_len, int argc, char* argv[])
+{
+    options opts;
+    opts.pass_cnt = pass_cnt;
+    opts.fpt_len = fpt_len;
+    std::vector<std::string> args;
+
+    // options affecting how files are hashed may appear anywhere
     for (int i = 1; i < argc; i++) {
         const std::string arg = argv[i];
 
+        if (arg == "--all") {
+            opts.all = true;
+        } else if (arg == "--chunks") {
+            opts.chunks = true;
+        } else if (arg.compare(0, 9, "--chunks=") == 0) {
+            if (!parse_chunk_sizes(arg.substr(9), opts.chunk_sizes)) {
+                std::cerr << "invalid chunk sizes: " << std::quoted(arg.substr(9)) << std::endl;
+                return 1;
+            }
+            opts.chunks = true;
+        } else if (arg == "--stats") {
+            if (!haval::stats_enabled) {
+                std::cerr << "--stats needs haval built with HAVAL_ENABLE_STATS" << std::endl;
+                return 1;
+            }
+            opts.stats = true;
+        } else if (arg == "--unordered") {
+            opts.ordered = false;
+        } else if (arg == "--fail-fast") {
+            opts.fail_fast = true;
+        } else if (arg == "--order=inode") {
+            opts.order = check_order::inode;
+        } else if (arg == "--order=extent") {
+            opts.order = check_order::extent;
+        } else if (arg.compare(0, 2, "-j") == 0) {
+            const std::string value = arg.size() > 2 ? arg.substr(2) : (i + 1 < argc ? argv[++i] : "");
+            char* value_end = nullptr;
+            const unsigned long thread_cnt = std::strtoul(value.c_str(), &value_end, 10);
+            if (value.empty() || *value_end != '\0') {
+                std::cerr << "invalid thread count: " << std::quoted(value) << std::endl;
+                return 1;
+            }
+            opts.thread_cnt = thread_cnt > 0 ? static_cast<unsigned int>(thread_cnt) : havalapp::default_thread_cnt();
+            opts.thread_cnt_set = true;
+        } else if (arg.compare(0, 5, "--io=") == 0) {
+            const std::string value = arg.substr(5);
+            if (value == "mmap") {
+                opts.io = havalapp::io_backend::mmap;
+#ifndef _WIN32
+            } else if (value == "uring") {
+                opts.io = havalapp::io_backend::uring;
+            } else if (value == "pread") {
+                opts.io = havalapp::io_backend::pread;
+#endif
+            } else {
+                std::cerr << "unsupported I/O method: " << std::quoted(value) << std::endl;
+                return 1;
+            }
+        } else if (arg.compare(0, 11, "--io-depth=") == 0) {
+            const std::string value = arg.substr(11);
+            char* value_end = nullptr;
+            const unsigned long io_depth = std::strtoul(value.c_str(), &value_end, 10);
+            if (value.empty() || *value_end != '\0' || io_depth == 0 || io_depth > 256) {
+                std::cerr << "invalid I/O queue depth: " << std::quoted(value) << std::endl;
+                return 1;
+            }
+            opts.io_depth = static_cast<unsigned int>(io_depth);
+        } else if (arg == "--tree") {
+            opts.tree_leaf_size = haval::tree_haval<3, 256>::default_leaf_size;
+        } else if (arg.compare(0, 7, "--tree=") == 0) {
+            if (!havalapp::parse_size(arg.substr(7), opts.tree_leaf_size) || opts.tree_leaf_size == 0) {
+                std::cerr << "invalid leaf size: " << std::quoted(arg.substr(7)) << std::endl;
+                return 1;
+            }
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (opts.all && opts.tree_leaf_size > 0) {
+        std::cerr << "--all can not be combined with --tree" << std::endl;
+        return 1;
+    }
+    if (opts.chunks && (opts.all || opts.tree_leaf_size > 0)) {
+        std::cerr << "--chunks can not be combined with --all or --tree" << std::endl;
+        return 1;
+    }
+
+    // one file at a time gets all the cores in tree mode
+    if (opts.tree_leaf_size > 0 && !opts.thread_cnt_set) {
+        opts.thread_cnt = havalapp::default_thread_cnt();
+    }
+
+    if (args.empty()) {
+        // filter
+        haval::reset_thread_stats();
+        if (opts.tree_leaf_size > 0) {
+            std::string digest;
+            try {
+                digest = tree_hash(nullptr, opts);
+            } catch (const std::system_error& e) {
+                std::cerr << "standard input can not be read: " << e.code().message() << std::endl;
+                return 1;
+            }
+            std::cout << to_hex(digest) << std::endl;
+            report_stats("-", haval::thread_stats(), opts);
+        } else if (opts.all) {
+            haval::all_variants context;
+            context.start();
+            if (!read_stdin(context)) {
+                return 1;
+            }
+            print_all("-", context.end());
+            report_stats("-", haval::thread_stats(), opts);
+        } else if (opts.chunks) {
+            // chunks of a stream are printed as they are found
+            haval::chunker<haval::dynamic_haval> chunker(opts.chunk_sizes, {pass_cnt, fpt_len});
+            chunker.start();
+            auto feeder = make_chunk_feeder(chunker, [](haval::chunk_record&& chunk) { print_chunk("-", chunk); });
+            if (!read_stdin(feeder)) {
+                return 1;
+            }
+            chunker.end(feeder.consume);
+            std::cout.flush();
+            report_stats("-", haval::thread_stats(), opts);
+        } else {
+            haval::dynamic_haval context(pass_cnt, fpt_len);
+            context.start();
+            if (!read_stdin(context)) {
+                return 1;
+            }
+            std::cout << to_hex(context.end()) << std::endl;
+            report_stats("-", haval::thread_stats(), opts);
+        }
+    }
+
+    int exit_code = 0;
+
+    // consecutive files are hashed as one batch
+    std::vector<std::string> files;
+
+    for (std::size_t i = 0; i < args.size(); i++) {
+        const std::string& arg = args[i];
+
+        if (arg != "?" && arg.compare(0, 1, "-") != 0) {
+            files.push_back(arg);
+            continue;
+        }
+
+        hash_files(files, opts);
+        files.clear();
+
         if (arg == "?" || arg == "-?" || arg == "-h") {
             // show help info
             usage(pass_cnt, fpt_len);
         } else if (arg.compare(0, 2, "-m") == 0) {
             // hash string
             const std::string data = arg.substr(2);
-            std::cout << "HAVAL(" << std::quoted(data) << ") = " << to_hex(hasher::hash(data)) << std::endl;
-        } else if (arg == "-s") {
-            // test speed
-            haval_speed<pass_cnt, fpt_len>();
+            std::cout << "HAVAL(" << std::quoted(data) << ") = " << to_hex(haval::dynamic_haval::hash(pass_cnt, fpt_len, data)) << std::endl;
+        } else if (arg.compare(0, 2, "-c") == 0) {
+            // check manifest
+            const std::string manifest = arg.size() > 2 ? arg.substr(2) : (i + 1 < args.size() ? args[++i] : "");
+            if (manifest.empty()) {
+                std::cerr << "missing manifest for -c" << std::endl;
+                return 1;
+            }
+            if (opts.all || opts.chunks) {
+                std::cerr << (opts.all ? "--all" : "--chunks") << " can not be combined with -c" << std::endl;
+                return 1;
+            }
+            if (!check_manifest(manifest, opts)) {
+                exit_code = 1;
+            }
+        } else if (arg.compare(0, 2, "-r") == 0) {
+            // hash directory tree
+            const std::string root = arg.size() > 2 ? arg.substr(2) : (i + 1 < args.size() ? args[++i] : "");
+            if (root.empty()) {
+                std::cerr << "missing directory for -r" << std::endl;
+                return 1;
+            }
+            if (opts.all || opts.chunks) {
+                std::cerr << (opts.all ? "--all" : "--chunks") << " can not be combined with -r" << std::endl;
+                return 1;
+            }
+            if (!hash_tree(root, opts)) {
+                exit_code = 1;
+            }
         } else if (arg == "-e") {
             // test endianity
             if (little_endian()) {
@@ -161,53 +774,31 @@ int main_impl(int argc, char* argv[])
                 std::cout << "You must NOT define HAVAL_LITTLE_ENDIAN." << std::endl;
             }
         } else {
-            // hash file
-            std::ifstream f(arg.c_str(), std::ios::in | std::ios::binary);
-            if (!f.good()) {
-                std::cout << arg << " can not be opened !" << std::endl;
-            } else {
-                std::cout << "HAVAL(" << arg << ") = " << to_hex(hasher::hash(f)) << std::endl;
-            }
+            files.push_back(arg);
         }
     }
 
-    return 0;
-}
+    hash_files(files, opts);
 
-template<unsigned int pass_cnt>
-int main_impl(unsigned int fpt_len, int argc, char* argv[])
-{
-    switch (fpt_len) {
-    case 128:
-        return main_impl<pass_cnt, 128>(argc, argv);
-    case 160:
-        return main_impl<pass_cnt, 160>(argc, argv);
-    case 192:
-        return main_impl<pass_cnt, 192>(argc, argv);
-    case 224:
-        return main_impl<pass_cnt, 224>(argc, argv);
-    case 256:
-    default:
-        return main_impl<pass_cnt, 256>(argc, argv);
-    }
-}
+    report_stats("total", total_stats, opts);
 
-int main_impl(unsigned int pass_cnt, unsigned int fpt_len, int argc, char* argv[])
-{
-    switch (pass_cnt) {
-    case 3:
-    default:
-        return main_impl<3>(fpt_len, argc, argv);
-    case 4:
-        return main_impl<4>(fpt_len, argc, argv);
-    case 5:
-        return main_impl<5>(fpt_len, argc, argv);
-    }
+    return exit_code;
 }
 
 } // namespace
 
 int main(int argc, char* argv[])
 {
-    return main_impl(get_env_uint("HAVAL_PASS", 3), get_env_uint("HAVAL_FPTLEN", 256), argc, argv);
+    unsigned int pass_cnt = get_env_uint("HAVAL_PASS", 3);
+    unsigned int fpt_len = get_env_uint("HAVAL_FPTLEN", 256);
+
+    // unsupported values fall back to the defaults
+    if (pass_cnt < 3 || pass_cnt > 5) {
+        pass_cnt = 3;
+    }
+    if (!haval::dynamic_haval::supported(pass_cnt, fpt_len)) {
+        fpt_len = 256;
+    }
+
+    return main_impl(pass_cnt, fpt_len, argc, argv);
 }
@@ -0,0 +1,500 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "haval-tree.hpp"
+#include "haval.hpp"
+#include "havalapp-data.h"
+#include "havalapp-size.h"
+
+#ifdef HAVAL_BENCH_DISPATCH
+#include "haval-dispatch.hpp"
+#endif
+
+#ifdef HAVAL_BENCH_QT
+#include "haval-qt.hpp"
+
+#include <QBuffer>
+#include <QByteArray>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define HAVAL_BENCH_TSC
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define HAVAL_BENCH_TSC
+#endif
+
+namespace
+{
+
+using clock_type = std::chrono::steady_clock;
+
+// what to measure and how
+struct settings {
+    std::vector<std::size_t> sizes;
+    std::vector<std::string> paths;
+    unsigned int pass_cnt = 0;
+    unsigned int fpt_len = 0;
+    unsigned int warmup_cnt = 2;
+    unsigned int rep_cnt = 11;
+    std::size_t chunk_size = 4096;
+    std::size_t leaf_size = 1024 * 1024;
+    std::vector<unsigned int> thread_cnts;
+    double min_sample_time = 0.001;
+};
+
+// outcome of a single measurement
+struct result {
+    unsigned int pass_cnt;
+    unsigned int fpt_len;
+    std::string path;
+    std::size_t size;
+    std::size_t bytes;
+    std::size_t iterations;
+    double median_ns;
+    double p99_ns;
+    double min_ns;
+    double cycles_per_byte;
+};
+
+// read the time stamp counter, if there is one
+std::uint64_t read_cycles()
+{
+#ifdef HAVAL_BENCH_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// make the compiler assume value is read, so that the hashing which produced it can not be dropped
+template<typename value_type>
+void do_not_optimize(const value_type& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r"(&value) : "memory");
+#else
+    static const void* volatile sink = nullptr;
+    sink = &value;
+#endif
+}
+
+// value at the given quantile of sorted samples, nearest rank
+double quantile(const std::vector<double>& sorted, double q)
+{
+    const auto rank = static_cast<std::size_t>(std::ceil(q * static_cast<double>(sorted.size())));
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// time body() which processes bytes bytes per call; small inputs are repeated
+// within a sample so that each sample runs for at least min_sample_time
+template<typename body_type>
+result measure(const settings& opts, std::size_t bytes, body_type body)
+{
+    // calibrate
+    auto start = clock_type::now();
+    body();
+    const double once = std::chrono::duration<double>(clock_type::now() - start).count();
+    const std::size_t iterations =
+            once >= opts.min_sample_time ? 1 : static_cast<std::size_t>(opts.min_sample_time / std::max(once, 1e-9)) + 1;
+
+    for (unsigned int i = 0; i < opts.warmup_cnt; i++) {
+        for (std::size_t j = 0; j < iterations; j++) {
+            body();
+        }
+    }
+
+    std::vector<double> times;
+    std::vector<double> cycles;
+
+    for (unsigned int i = 0; i < opts.rep_cnt; i++) {
+        const std::uint64_t start_cycles = read_cycles();
+        start = clock_type::now();
+        for (std::size_t j = 0; j < iterations; j++) {
+            body();
+        }
+        const auto elapsed = clock_type::now() - start;
+        const std::uint64_t elapsed_cycles = read_cycles() - start_cycles;
+
+        times.push_back(std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations));
+        cycles.push_back(static_cast<double>(elapsed_cycles) / static_cast<double>(iterations));
+    }
+
+    std::sort(times.begin(), times.end());
+    std::sort(cycles.begin(), cycles.end());
+
+    result r = {};
+    r.bytes = bytes;
+    r.iterations = iterations;
+    r.median_ns = quantile(times, 0.5);
+    r.p99_ns = quantile(times, 0.99);
+    r.min_ns = times.front();
+    r.cycles_per_byte = bytes > 0 ? quantile(cycles, 0.5) / static_cast<double>(bytes) : 0;
+    return r;
+}
+
+// read-only stream over a memory region, rewound before each use
+class memory_buffer : public std::streambuf
+{
+public:
+    memory_buffer(const std::uint8_t* data, std::size_t size) :
+        m_data(reinterpret_cast<char*>(const_cast<std::uint8_t*>(data))),
+        m_size(size)
+    {
+    }
+
+    void rewind()
+    {
+        setg(m_data, m_data, m_data + m_size);
+    }
+
+private:
+    char* m_data;
+    std::size_t m_size;
+};
+
+bool wants_path(const settings& opts, const std::string& path)
+{
+    return opts.paths.empty() || std::find(opts.paths.begin(), opts.paths.end(), path) != opts.paths.end();
+}
+
+// run all measurements for one HAVAL variant
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void bench_variant(const settings& opts, const std::uint8_t* data, std::vector<result>& results)
+{
+    using hasher = haval::haval<pass_cnt, fpt_len>;
+
+    if ((opts.pass_cnt != 0 && opts.pass_cnt != pass_cnt) || (opts.fpt_len != 0 && opts.fpt_len != fpt_len)) {
+        return;
+    }
+
+    const auto add = [&](const char* path, std::size_t size, result r) {
+        r.pass_cnt = pass_cnt;
+        r.fpt_len = fpt_len;
+        r.path = path;
+        r.size = size;
+        results.push_back(r);
+        std::cerr << "PASS=" << pass_cnt << " FPTLEN=" << fpt_len << " " << path << " " << size << " B: " << std::fixed
+                  << std::setprecision(1) << r.median_ns << " ns" << std::endl;
+    };
+
+    for (const std::size_t size : opts.sizes) {
+        if (wants_path(opts, "oneshot")) {
+            add("oneshot", size, measure(opts, size, [&] { do_not_optimize(hasher::hash(data, size)); }));
+        }
+
+        if (wants_path(opts, "streaming")) {
+            add("streaming", size, measure(opts, size, [&] {
+                hasher context;
+                context.start();
+                for (std::size_t i = 0; i < size; i += opts.chunk_size) {
+                    context.update(data + i, std::min(opts.chunk_size, size - i));
+                }
+                do_not_optimize(context.end());
+            }));
+        }
+
+        if (wants_path(opts, "istream")) {
+            memory_buffer buffer(data, size);
+            add("istream", size, measure(opts, size, [&] {
+                buffer.rewind();
+                std::istream stream(&buffer);
+                do_not_optimize(hasher::hash(stream));
+            }));
+        }
+
+        // thread scaling of the tree construction
+        for (const unsigned int thread_cnt : opts.thread_cnts) {
+            const std::string path = "tree-" + std::to_string(thread_cnt);
+            if (wants_path(opts, "tree") || wants_path(opts, path)) {
+                add(path.c_str(), size, measure(opts, size, [&] {
+                    do_not_optimize(haval::tree_haval<pass_cnt, fpt_len>::hash(data, size, opts.leaf_size, thread_cnt));
+                }));
+            }
+        }
+
+#ifdef HAVAL_BENCH_QT
+        if (wants_path(opts, "qt") && size <= static_cast<std::size_t>(std::numeric_limits<int>::max())) {
+            const QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char*>(data), static_cast<int>(size));
+            add("qt", size, measure(opts, size, [&] {
+                QBuffer buffer;
+                buffer.setData(bytes);
+                buffer.open(QIODevice::ReadOnly);
+                do_not_optimize(haval::QHaval<pass_cnt, fpt_len>::hash(&buffer));
+            }));
+        }
+#endif
+
+#ifdef HAVAL_BENCH_DISPATCH
+        // every lane hashes the same input, throughput counts all of them
+        using multi_hasher = haval::dispatched_multi_haval<pass_cnt, fpt_len>;
+        for (haval::kernel k : {haval::kernel::scalar, haval::kernel::sse2, haval::kernel::avx2, haval::kernel::avx512}) {
+            const std::string path = std::string("multi-") + haval::kernel_name(k);
+            if (!wants_path(opts, path) || !haval::set_kernel(k)) {
+                continue;
+            }
+
+            const void* lane_data[multi_hasher::lane_cnt];
+            std::size_t lane_lens[multi_hasher::lane_cnt];
+            std::uint8_t digests[multi_hasher::lane_cnt][fpt_len >> 3];
+            void* lane_results[multi_hasher::lane_cnt];
+            for (unsigned int l = 0; l < multi_hasher::lane_cnt; l++) {
+                lane_data[l] = data;
+                lane_lens[l] = size;
+                lane_results[l] = digests[l];
+            }
+
+            add(path.c_str(), size, measure(opts, size * multi_hasher::lane_cnt, [&] {
+                multi_hasher::hash(lane_data, lane_lens, lane_results);
+                do_not_optimize(digests);
+            }));
+        }
+#endif
+    }
+}
+
+template<unsigned int pass_cnt>
+void bench_pass(const settings& opts, const std::uint8_t* data, std::vector<result>& results)
+{
+    bench_variant<pass_cnt, 128>(opts, data, results);
+    bench_variant<pass_cnt, 160>(opts, data, results);
+    bench_variant<pass_cnt, 192>(opts, data, results);
+    bench_variant<pass_cnt, 224>(opts, data, results);
+    bench_variant<pass_cnt, 256>(opts, data, results);
+}
+
+// escape a string for JSON
+std::string json_string(const std::string& value)
+{
+    std::ostringstream stream;
+    stream << '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            stream << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            stream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int{c} << std::dec;
+        } else {
+            stream << c;
+        }
+    }
+    stream << '"';
+    return stream.str();
+}
+
+void write_json(std::ostream& stream, const settings& opts, const std::vector<result>& results)
+{
+    stream << std::fixed << std::setprecision(3);
+    stream << "{\n";
+    stream << "  \"clock\": \"steady_clock\",\n";
+#ifdef HAVAL_BENCH_TSC
+    stream << "  \"cycle_counter\": \"tsc\",\n";
+#else
+    stream << "  \"cycle_counter\": null,\n";
+#endif
+    stream << "  \"warmup\": " << opts.warmup_cnt << ",\n";
+    stream << "  \"repetitions\": " << opts.rep_cnt << ",\n";
+    stream << "  \"chunk_size\": " << opts.chunk_size << ",\n";
+    stream << "  \"leaf_size\": " << opts.leaf_size << ",\n";
+    stream << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+    stream << "  \"results\": [";
+
+    for (std::size_t i = 0; i < results.size(); i++) {
+        const result& r = results[i];
+        const double mib_per_s = r.median_ns > 0 ? static_cast<double>(r.bytes) / r.median_ns * 1e9 / (1024 * 1024) : 0;
+
+        stream << (i > 0 ? "," : "") << "\n    {";
+        stream << "\"pass\": " << r.pass_cnt << ", ";
+        stream << "\"fpt_len\": " << r.fpt_len << ", ";
+        stream << "\"path\": " << json_string(r.path) << ", ";
+        stream << "\"size\": " << r.size << ", ";
+        stream << "\"bytes\": " << r.bytes << ", ";
+        stream << "\"iterations\": " << r.iterations << ", ";
+        stream << "\"median_ns\": " << r.median_ns << ", ";
+        stream << "\"p99_ns\": " << r.p99_ns << ", ";
+        stream << "\"min_ns\": " << r.min_ns << ", ";
+        stream << "\"mib_per_s\": " << mib_per_s << ", ";
+#ifdef HAVAL_BENCH_TSC
+        stream << "\"cycles_per_byte\": " << r.cycles_per_byte;
+#else
+        stream << "\"cycles_per_byte\": null";
+#endif
+        stream << "}";
+    }
+
+    stream << "\n  ]\n}\n";
+}
+
+std::vector<std::string> split(const std::string& text)
+{
+    std::vector<std::string> items;
+    std::istringstream stream(text);
+    for (std::string item; std::getline(stream, item, ',');) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+// print usage
+void usage()
+{
+    std::cerr << "Usage: havalbench [OPTION]..." << std::endl
+              << "Measures HAVAL throughput and prints the results as JSON." << std::endl
+              << std::endl
+              << "    --sizes=LIST       message sizes, e.g. 0,64,1K,1M (default: 0 B to --max-size in steps of 4x)" << std::endl
+              << "    --max-size=SIZE    largest default message size, up to 1G (default: 16M)" << std::endl
+              << "    --paths=LIST       oneshot, streaming, istream, tree, tree-<threads>, qt, multi-<kernel>" << std::endl
+              << "                       (default: all available)" << std::endl
+              << "    --pass=N           only measure N passes" << std::endl
+              << "    --fptlen=N         only measure N-bit fingerprints" << std::endl
+              << "    --warmup=N         untimed samples before measuring (default: 2)" << std::endl
+              << "    --reps=N           timed samples per measurement (default: 11)" << std::endl
+              << "    --chunk=SIZE       update() size for the streaming path (default: 4K)" << std::endl
+              << "    --leaf=SIZE        leaf size for the tree paths (default: 1M)" << std::endl
+              << "    --threads=LIST     thread counts for the tree paths (default: powers of two up to one per core)"
+              << std::endl
+              << "    --output=FILE      write JSON to FILE instead of standard output" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    settings opts;
+    std::size_t max_size = std::size_t{16} << 20;
+    std::string output;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const std::size_t eq = arg.find('=');
+        const std::string key = arg.substr(0, eq);
+        const std::string value = eq != std::string::npos ? arg.substr(eq + 1) : std::string();
+        bool ok = eq != std::string::npos;
+
+        if (arg == "-h" || arg == "--help") {
+            usage();
+            return 0;
+        } else if (key == "--sizes") {
+            for (const std::string& item : split(value)) {
+                std::size_t size = 0;
+                ok = ok && havalapp::parse_size(item, size);
+                opts.sizes.push_back(size);
+            }
+        } else if (key == "--max-size") {
+            ok = ok && havalapp::parse_size(value, max_size);
+        } else if (key == "--paths") {
+            opts.paths = split(value);
+        } else if (key == "--pass") {
+            opts.pass_cnt = static_cast<unsigned int>(std::atoi(value.c_str()));
+        } else if (key == "--fptlen") {
+            opts.fpt_len = static_cast<unsigned int>(std::atoi(value.c_str()));
+        } else if (key == "--warmup") {
+            opts.warmup_cnt = static_cast<unsigned int>(std::atoi(value.c_str()));
+        } else if (key == "--reps") {
+            opts.rep_cnt = static_cast<unsigned int>(std::atoi(value.c_str()));
+            ok = ok && opts.rep_cnt > 0;
+        } else if (key == "--chunk") {
+            ok = ok && havalapp::parse_size(value, opts.chunk_size) && opts.chunk_size > 0;
+        } else if (key == "--leaf") {
+            ok = ok && havalapp::parse_size(value, opts.leaf_size) && opts.leaf_size > 0;
+        } else if (key == "--threads") {
+            for (const std::string& item : split(value)) {
+                const int thread_cnt = std::atoi(item.c_str());
+                ok = ok && thread_cnt > 0;
+                opts.thread_cnts.push_back(static_cast<unsigned int>(thread_cnt));
+            }
+        } else if (key == "--output") {
+            output = value;
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            std::cerr << "invalid argument: " << arg << std::endl;
+            usage();
+            return 1;
+        }
+    }
+
+    if (opts.sizes.empty()) {
+        opts.sizes.push_back(0);
+        for (std::size_t size = 16; size <= max_size && size <= (std::size_t{1} << 30); size *= 4) {
+            opts.sizes.push_back(size);
+        }
+    }
+
+    if (opts.thread_cnts.empty()) {
+        const unsigned int core_cnt = std::max(std::thread::hardware_concurrency(), 1u);
+        for (unsigned int thread_cnt = 1; thread_cnt < core_cnt; thread_cnt *= 2) {
+            opts.thread_cnts.push_back(thread_cnt);
+        }
+        opts.thread_cnts.push_back(core_cnt);
+    }
+
+    // pseudo-random input, so that no path benefits from repeating patterns
+    const std::size_t data_size = std::max<std::size_t>(*std::max_element(opts.sizes.begin(), opts.sizes.end()), 1);
+    const std::unique_ptr<std::uint8_t[]> data(new std::uint8_t[data_size]);
+    std::uint32_t seed = 1;
+    havalapp::fill_data(data.get(), data_size, seed);
+
+    std::vector<result> results;
+    bench_pass<3>(opts, data.get(), results);
+    bench_pass<4>(opts, data.get(), results);
+    bench_pass<5>(opts, data.get(), results);
+
+    if (output.empty()) {
+        write_json(std::cout, opts, results);
+    } else {
+        std::ofstream file(output.c_str(), std::ios::out | std::ios::trunc);
+        write_json(file, opts, results);
+        if (!file.good()) {
+            std::cerr << output << " can not be written !" << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,139 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "haval-c.h"
+#include "haval.hpp"
+#include "havaltest-util.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+int exit_code = 0;
+
+void check(bool result, const char* what)
+{
+    if (!result) {
+        std::cout << "  " << what << " failed" << std::endl;
+        exit_code = 1;
+    }
+}
+
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void test()
+{
+    using hasher = haval::haval<pass_cnt, fpt_len>;
+
+    std::cout << "C API (PASS=" << pass_cnt << ", FPTLEN=" << fpt_len << ")" << std::endl;
+
+    check(haval_digest_size(fpt_len) == hasher::result_size, "haval_digest_size");
+
+    // messages of all sorts of lengths, hashed one by one as reference
+    std::vector<std::vector<std::uint8_t>> messages;
+    std::vector<std::string> expected;
+    std::vector<const void*> data;
+    std::vector<std::size_t> data_len;
+    std::vector<std::uint8_t> concat;
+    for (std::size_t i = 0; i < 37; i++) {
+        messages.push_back(havaltest::make_data(i * i * 7 % 1000, static_cast<std::uint32_t>(i)));
+        expected.push_back(hasher::hash(messages[i].data(), messages[i].size()));
+        concat.insert(concat.end(), messages[i].begin(), messages[i].end());
+    }
+    for (const auto& message : messages) {
+        data.push_back(message.data());
+        data_len.push_back(message.size());
+    }
+
+    // both sides of the short message path
+    std::string digest(hasher::result_size, '\0');
+    for (std::size_t i = 0; i < messages.size(); i++) {
+        check(haval_hash(pass_cnt, fpt_len, data[i], data_len[i], &digest[0]) == 0 && digest == expected[i],
+                "haval_hash");
+    }
+
+    std::string digests(hasher::result_size * messages.size(), '\0');
+    check(haval_hash_batch(pass_cnt, fpt_len, data.data(), data_len.data(), messages.size(), &digests[0]) == 0,
+            "haval_hash_batch");
+    for (std::size_t i = 0; i < messages.size(); i++) {
+        check(digests.compare(i * hasher::result_size, hasher::result_size, expected[i]) == 0, "haval_hash_batch digest");
+    }
+
+    digests.assign(digests.size(), '\0');
+    check(haval_hash_concat(pass_cnt, fpt_len, concat.data(), data_len.data(), messages.size(), &digests[0]) == 0,
+            "haval_hash_concat");
+    for (std::size_t i = 0; i < messages.size(); i++) {
+        check(digests.compare(i * hasher::result_size, hasher::result_size, expected[i]) == 0,
+                "haval_hash_concat digest");
+    }
+
+    // streaming in odd pieces, twice to make sure haval_final starts over
+    haval_state* const state = haval_create(pass_cnt, fpt_len);
+    check(state != nullptr, "haval_create");
+    if (state != nullptr) {
+        for (int round = 0; round < 2; round++) {
+            const auto& message = messages[36];
+            for (std::size_t offset = 0; offset < message.size(); offset += 113) {
+                haval_update(state, &message[offset], std::min<std::size_t>(113, message.size() - offset));
+            }
+            digest.assign(digest.size(), '\0');
+            haval_final(state, &digest[0]);
+            check(digest == expected[36], "haval_final");
+        }
+        haval_destroy(state);
+    }
+
+    std::ifstream f("pi.frac", std::ios::in | std::ios::binary);
+    if (f.good()) {
+        check(haval_hash_file(pass_cnt, fpt_len, "pi.frac", &digest[0]) == 0 && digest == hasher::hash(f),
+                "haval_hash_file");
+    }
+}
+
+} // namespace
+
+int main()
+{
+    havaltest::for_each_variant([&](auto variant) {
+        test<decltype(variant)::pass_cnt, decltype(variant)::fpt_len>();
+    });
+
+    std::uint8_t digest[32];
+    check(haval_digest_size(100) == 0, "haval_digest_size of an unsupported length");
+    check(haval_hash(6, 256, "", 0, digest) == EINVAL, "haval_hash of an unsupported variant");
+    check(haval_create(3, 100) == nullptr, "haval_create of an unsupported variant");
+    check(haval_hash_file(3, 256, "no such file", digest) == ENOENT, "haval_hash_file of a missing file");
+
+    return exit_code;
+}
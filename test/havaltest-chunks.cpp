@@ -0,0 +1,169 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "haval-chunks.hpp"
+#include "haval-dynamic.hpp"
+#include "havaltest-util.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+int exit_code = 0;
+
+// chunk data fed in pieces of piece_size bytes
+template<typename hasher_type>
+std::vector<haval::chunk_record> split(
+        haval::chunker<hasher_type>& chunker, const std::vector<std::uint8_t>& data, std::size_t piece_size)
+{
+    std::vector<haval::chunk_record> chunks;
+    const auto consume = [&chunks](haval::chunk_record&& chunk) { chunks.push_back(std::move(chunk)); };
+
+    chunker.start();
+    for (std::size_t offset = 0; offset < data.size(); offset += piece_size) {
+        chunker.update(&data[offset], std::min(piece_size, data.size() - offset), consume);
+    }
+    chunker.end(consume);
+    return chunks;
+}
+
+bool same_chunks(const std::vector<haval::chunk_record>& lhs, const std::vector<haval::chunk_record>& rhs)
+{
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](const auto& l, const auto& r) {
+        return l.offset == r.offset && l.length == r.length && l.digest == r.digest;
+    });
+}
+
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void test(const std::vector<std::uint8_t>& data, const haval::chunk_sizes& sizes)
+{
+    haval::chunker<haval::haval<pass_cnt, fpt_len>> chunker(sizes);
+    const std::vector<haval::chunk_record> chunks = split(chunker, data, data.size() + 1);
+
+    // chunks cover the data in order, stay within the limits and carry the digests of their bytes
+    std::uint64_t offset = 0;
+    for (std::size_t i = 0; i < chunks.size(); i++) {
+        const haval::chunk_record& chunk = chunks[i];
+        const bool last = i + 1 == chunks.size();
+        if (chunk.offset != offset || chunk.length > sizes.max || (!last && chunk.length < sizes.min) ||
+            chunk.digest != haval::haval<pass_cnt, fpt_len>::hash(&data[offset], chunk.length)) {
+            std::cout << "  bad chunk " << i << " (PASS=" << pass_cnt << ", FPTLEN=" << fpt_len << ", size "
+                      << data.size() << ")" << std::endl;
+            exit_code = 1;
+            return;
+        }
+        offset += chunk.length;
+    }
+    if (offset != data.size()) {
+        std::cout << "  chunks do not cover the data (PASS=" << pass_cnt << ", FPTLEN=" << fpt_len << ", size "
+                  << data.size() << ")" << std::endl;
+        exit_code = 1;
+    }
+
+    // boundaries do not depend on how the data is fed
+    for (std::size_t piece_size : {1u, 77u, 4096u}) {
+        if (!same_chunks(split(chunker, data, piece_size), chunks)) {
+            std::cout << "  streaming mismatch in pieces of " << piece_size << " (PASS=" << pass_cnt
+                      << ", FPTLEN=" << fpt_len << ", size " << data.size() << ")" << std::endl;
+            exit_code = 1;
+        }
+    }
+}
+
+} // namespace
+
+int main()
+{
+    std::cout << "HAVAL content-defined chunking" << std::endl;
+
+    const haval::chunk_sizes sizes{512, 2048, 16 * 1024};
+
+    for (std::size_t size : {0u, 1u, 511u, 16u * 1024, 256u * 1024}) {
+        const std::vector<std::uint8_t> data = havaltest::make_data(size);
+
+        havaltest::for_each_variant([&](auto variant) {
+            test<decltype(variant)::pass_cnt, decltype(variant)::fpt_len>(data, sizes);
+        });
+    }
+
+    const std::vector<std::uint8_t> data = havaltest::make_data(1024 * 1024);
+
+    // a fixed minimum, average and maximum size
+    test<3, 256>(data, haval::chunk_sizes{4096, 4096, 4096});
+
+    // the run time variant gives the same chunks
+    {
+        haval::chunker<haval::haval<4, 192>> chunker(sizes);
+        haval::chunker<haval::dynamic_haval> dynamic_chunker(sizes, haval::dynamic_haval(4, 192));
+        if (!same_chunks(split(dynamic_chunker, data, 65536), split(chunker, data, 65536))) {
+            std::cout << "  dynamic_haval mismatch" << std::endl;
+            exit_code = 1;
+        }
+    }
+
+    // boundaries resynchronize after an insertion, so most chunks are still found
+    {
+        std::vector<std::uint8_t> edited = data;
+        edited.insert(edited.begin() + 1000, {'H', 'A', 'V', 'A', 'L'});
+
+        haval::chunker<haval::haval<3, 256>> chunker(sizes);
+        const std::vector<haval::chunk_record> chunks = split(chunker, data, 65536);
+        std::set<std::string> digests;
+        for (const auto& chunk : split(chunker, edited, 65536)) {
+            digests.insert(chunk.digest);
+        }
+
+        const auto shared_cnt = std::count_if(chunks.begin(), chunks.end(), [&](const auto& chunk) {
+            return digests.count(chunk.digest) > 0;
+        });
+        if (chunks.size() < 100 || static_cast<std::size_t>(shared_cnt) + 5 < chunks.size()) {
+            std::cout << "  only " << shared_cnt << " of " << chunks.size() << " chunks survive an insertion"
+                      << std::endl;
+            exit_code = 1;
+        }
+    }
+
+    for (const haval::chunk_sizes& invalid : {haval::chunk_sizes{0, 2048, 4096}, haval::chunk_sizes{4096, 2048, 8192},
+                 haval::chunk_sizes{512, 4096, 2048}, haval::chunk_sizes{16, 32, 64}}) {
+        try {
+            haval::chunker<haval::haval<3, 256>> chunker(invalid);
+            std::cout << "  invalid sizes accepted" << std::endl;
+            exit_code = 1;
+        } catch (const std::invalid_argument&) {
+        }
+    }
+
+    return exit_code;
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "haval.hpp"
+#include "havaltest-util.h"
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+// digests known to the compiler
+constexpr auto empty_3_128 = haval::haval<3, 128>::const_hash("");
+constexpr auto empty_4_192 = haval::haval<4, 192>::const_hash("");
+constexpr auto empty_5_256 = haval::haval<5, 256>::const_hash("");
+
+static_assert(empty_3_128[0] == 0xC6 && empty_3_128[15] == 0x70, "");
+static_assert(empty_4_192[0] == 0x4A && empty_4_192[23] == 0xDA, "");
+static_assert(empty_5_256[0] == 0xBE && empty_5_256[31] == 0x30, "");
+
+int exit_code = 0;
+
+template<typename hasher>
+void verify(const char* name, const typename hasher::digest_type& digest, const std::string& data)
+{
+    if (std::string(digest.begin(), digest.end()) != hasher::hash(data)) {
+        std::cout << "  mismatch for " << name << std::endl;
+        exit_code = 1;
+    }
+}
+
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void test()
+{
+    using hasher = haval::haval<pass_cnt, fpt_len>;
+
+    std::cout << "HAVAL compile-time (PASS=" << pass_cnt << ", FPTLEN=" << fpt_len << ")" << std::endl;
+
+    constexpr auto empty = hasher::const_hash("");
+    constexpr auto one = hasher::const_hash("a");
+    constexpr auto name = hasher::const_hash("HAVAL");
+    constexpr auto digits = hasher::const_hash("0123456789");
+    constexpr auto alphabet = hasher::const_hash("abcdefghijklmnopqrstuvwxyz");
+    constexpr auto alphanumeric = hasher::const_hash("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789");
+    constexpr auto array = hasher::const_hash(std::array<char, 5>{{'H', 'A', 'V', 'A', 'L'}});
+
+    // more than one block, with the tail spilling into a block of its own
+    constexpr auto long_text = hasher::const_hash(
+            "The quick brown fox jumps over the lazy dog. The quick brown fox jumps over the lazy dog. "
+            "The quick brown fox jumps over the lazy dog. The quick brown fox jumps over the lazy dog. "
+            "The quick brown fox jumps over the lazy dog.");
+
+    verify<hasher>("\"\"", empty, "");
+    verify<hasher>("\"a\"", one, "a");
+    verify<hasher>("\"HAVAL\"", name, "HAVAL");
+    verify<hasher>("\"0123456789\"", digits, "0123456789");
+    verify<hasher>("\"abcdefghijklmnopqrstuvwxyz\"", alphabet, "abcdefghijklmnopqrstuvwxyz");
+    verify<hasher>("alphanumeric", alphanumeric, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789");
+    verify<hasher>("std::array", array, "HAVAL");
+    verify<hasher>("long text",
+            long_text,
+            "The quick brown fox jumps over the lazy dog. The quick brown fox jumps over the lazy dog. "
+            "The quick brown fox jumps over the lazy dog. The quick brown fox jumps over the lazy dog. "
+            "The quick brown fox jumps over the lazy dog.");
+}
+
+} // namespace
+
+int main()
+{
+    havaltest::for_each_variant([](auto variant) { test<decltype(variant)::pass_cnt, decltype(variant)::fpt_len>(); });
+
+    return exit_code;
+}
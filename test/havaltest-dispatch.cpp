@@ -0,0 +1,108 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "haval-dispatch.hpp"
+#include "havaltest-util.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+int exit_code = 0;
+
+template<unsigned int pass_cnt, unsigned int fpt_len, unsigned int lanes>
+void test_lanes()
+{
+    using hasher = haval::dispatched_multi_haval<pass_cnt, fpt_len, lanes>;
+
+    std::vector<std::uint8_t> data[lanes];
+    std::string results[lanes];
+    const void* data_ptrs[lanes];
+    std::size_t data_lens[lanes];
+    void* result_ptrs[lanes];
+
+    std::uint32_t seed = 1;
+    for (unsigned int l = 0; l < lanes; l++) {
+        data[l].resize(l * 61);
+        havaltest::fill_data(data[l].data(), data[l].size(), seed);
+        results[l].resize(hasher::result_size);
+        data_ptrs[l] = data[l].data();
+        data_lens[l] = data[l].size();
+        result_ptrs[l] = &results[l][0];
+    }
+
+    hasher::hash(data_ptrs, data_lens, result_ptrs);
+
+    for (unsigned int l = 0; l < lanes; l++) {
+        if (results[l] != haval::haval<pass_cnt, fpt_len>::hash(data[l].data(), data[l].size())) {
+            std::cout << "  mismatch (PASS=" << pass_cnt << ", FPTLEN=" << fpt_len << ", lanes=" << lanes << ", lane=" << l
+                      << ")" << std::endl;
+            exit_code = 1;
+        }
+    }
+}
+
+template<unsigned int pass_cnt>
+void test_pass()
+{
+    test_lanes<pass_cnt, 128, 5>();
+    test_lanes<pass_cnt, 160, 16>();
+    test_lanes<pass_cnt, 192, 7>();
+    test_lanes<pass_cnt, 224, 32>();
+    test_lanes<pass_cnt, 256, 17>();
+}
+
+} // namespace
+
+int main()
+{
+    const haval::kernel best = haval::active_kernel();
+
+    for (haval::kernel k : {haval::kernel::scalar, haval::kernel::sse2, haval::kernel::avx2, haval::kernel::avx512}) {
+        if (!haval::set_kernel(k)) {
+            std::cout << "Kernel " << haval::kernel_name(k) << " is not supported, skipping" << std::endl;
+            continue;
+        }
+
+        std::cout << "Kernel " << haval::kernel_name(k) << (k == best ? " (default)" : "") << std::endl;
+
+        if (haval::active_kernel() != k) {
+            exit_code = 1;
+        }
+
+        test_pass<3>();
+        test_pass<4>();
+        test_pass<5>();
+    }
+
+    return exit_code;
+}
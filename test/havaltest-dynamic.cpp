@@ -0,0 +1,114 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "haval-dynamic.hpp"
+#include "havaltest-util.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+int exit_code = 0;
+
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void test()
+{
+    using hasher = haval::haval<pass_cnt, fpt_len>;
+
+    std::cout << "dynamic HAVAL (PASS=" << pass_cnt << ", FPTLEN=" << fpt_len << ")" << std::endl;
+
+    for (std::size_t size : {0u, 1u, 117u, 118u, 127u, 128u, 245u, 246u, 1000u, 4096u + 17}) {
+        const std::vector<std::uint8_t> data = havaltest::make_data(size);
+        const std::string expected = hasher::hash(data.data(), data.size());
+
+        // one-shot
+        if (haval::dynamic_haval::hash(pass_cnt, fpt_len, data.data(), data.size()) != expected) {
+            std::cout << "  one-shot mismatch (size " << size << ")" << std::endl;
+            exit_code = 1;
+        }
+
+        // streaming in odd pieces, reusing the hasher
+        haval::dynamic_haval context(pass_cnt, fpt_len);
+        for (int round = 0; round < 2; round++) {
+            context.start();
+            for (std::size_t offset = 0; offset < size; offset += 61) {
+                context.update(&data[offset], std::min<std::size_t>(61, size - offset));
+            }
+            if (context.end() != expected) {
+                std::cout << "  streaming mismatch (size " << size << ", round " << round << ")" << std::endl;
+                exit_code = 1;
+            }
+        }
+    }
+
+    std::ifstream f("pi.frac", std::ios::in | std::ios::binary);
+    if (f.good()) {
+        const std::string expected = hasher::hash(f);
+        f.clear();
+        f.seekg(0);
+        if (haval::dynamic_haval::hash(pass_cnt, fpt_len, f) != expected ||
+                haval::dynamic_haval::hash_file(pass_cnt, fpt_len, "pi.frac") != expected) {
+            std::cout << "  file mismatch" << std::endl;
+            exit_code = 1;
+        }
+    }
+}
+
+void test_unsupported(unsigned int pass_cnt, unsigned int fpt_len)
+{
+    try {
+        haval::dynamic_haval context(pass_cnt, fpt_len);
+        std::cout << "  PASS=" << pass_cnt << ", FPTLEN=" << fpt_len << " accepted" << std::endl;
+        exit_code = 1;
+    } catch (const std::invalid_argument&) {
+    }
+}
+
+} // namespace
+
+int main()
+{
+    havaltest::for_each_variant([&](auto variant) {
+        test<decltype(variant)::pass_cnt, decltype(variant)::fpt_len>();
+    });
+
+    test_unsupported(2, 256);
+    test_unsupported(6, 256);
+    test_unsupported(3, 96);
+    test_unsupported(3, 200);
+    test_unsupported(3, 288);
+
+    return exit_code;
+}
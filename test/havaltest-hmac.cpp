@@ -0,0 +1,102 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "haval-hmac.hpp"
+#include "havaltest-util.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+int exit_code = 0;
+
+// deterministic pseudo-random test data
+// HMAC spelled out with plain hashing, H((K ^ opad) || H((K ^ ipad) || m))
+template<unsigned int pass_cnt, unsigned int fpt_len>
+std::string reference_hmac(std::string key, const std::string& message)
+{
+    using hasher = haval::haval<pass_cnt, fpt_len>;
+
+    if (key.size() > 128) {
+        key = hasher::hash(key);
+    }
+    key.resize(128, '\0');
+
+    std::string inner_pad = key;
+    std::string outer_pad = key;
+    for (std::size_t i = 0; i < key.size(); i++) {
+        inner_pad[i] = static_cast<char>(inner_pad[i] ^ 0x36);
+        outer_pad[i] = static_cast<char>(outer_pad[i] ^ 0x5C);
+    }
+
+    return hasher::hash(outer_pad + hasher::hash(inner_pad + message));
+}
+
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void test()
+{
+    using mac = haval::hmac<pass_cnt, fpt_len>;
+
+    std::cout << "HMAC-HAVAL (PASS=" << pass_cnt << ", FPTLEN=" << fpt_len << ")" << std::endl;
+
+    for (std::size_t key_len : {0, 20, 127, 128, 129, 300}) {
+        const std::string key_data = havaltest::make_string(key_len, static_cast<std::uint32_t>(key_len + 1));
+        const typename mac::key key(key_data);
+
+        for (std::size_t message_len : {0, 1, 117, 128, 1000}) {
+            const std::string message = havaltest::make_string(message_len, static_cast<std::uint32_t>(message_len + 100));
+            const std::string expected = reference_hmac<pass_cnt, fpt_len>(key_data, message);
+
+            // the same key serves any number of messages
+            mac context(key);
+            context.start();
+            context.update(message.data(), message.size() / 2);
+            context.update(message.data() + message.size() / 2, message.size() - message.size() / 2);
+
+            if (mac::hash(key, message) != expected || context.end() != expected) {
+                std::cout << "  mismatch (key length " << key_len << ", message length " << message_len << ")"
+                          << std::endl;
+                exit_code = 1;
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main()
+{
+    havaltest::for_each_variant([&](auto variant) {
+        test<decltype(variant)::pass_cnt, decltype(variant)::fpt_len>();
+    });
+
+    return exit_code;
+}
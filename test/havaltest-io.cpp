@@ -0,0 +1,194 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "haval.hpp"
+#include "havalapp-io.h"
+#include "havaltest-util.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+
+using hasher = haval::haval<3, 256>;
+
+int exit_code = 0;
+
+constexpr std::size_t block_size = 4096;
+
+// a temporary file holding data, removed on destruction
+class temp_file
+{
+public:
+    explicit temp_file(const std::vector<std::uint8_t>& data)
+    {
+        char path[] = "/tmp/havaltest-io-XXXXXX";
+        const int fd = mkstemp(path);
+        if (fd < 0 || write(fd, data.data(), data.size()) != static_cast<ssize_t>(data.size())) {
+            std::cout << "  can not create a temporary file" << std::endl;
+            std::exit(1);
+        }
+        close(fd);
+        m_path = path;
+    }
+
+    ~temp_file()
+    {
+        unlink(m_path.c_str());
+    }
+
+    const std::string& path() const
+    {
+        return m_path;
+    }
+
+private:
+    std::string m_path;
+};
+
+// hash the rest of fd through a pipeline
+std::string read_hash(havalapp::read_pipeline& pipeline, int fd)
+{
+    hasher context;
+    context.start();
+    pipeline.read(fd, [&context](const void* data, std::size_t size) { context.update(data, size); });
+    return context.end();
+}
+
+void check(const std::string& got, const std::string& expected, const char* what, std::size_t size, unsigned int depth)
+{
+    if (got != expected) {
+        std::cout << "  " << what << " mismatch (size " << size << ", depth " << depth << ")" << std::endl;
+        exit_code = 1;
+    }
+}
+
+void test_backend(havalapp::io_backend backend, const char* name)
+{
+    for (unsigned int depth : {1u, 4u}) {
+        // one pipeline for all files, as each haval worker thread does
+        havalapp::read_pipeline pipeline(backend, depth, block_size);
+        std::cout << name << ", depth " << depth
+                  << (pipeline.backend() != backend ? " (not available, using pread)" : "") << std::endl;
+
+        for (std::size_t size : {std::size_t{0}, std::size_t{1}, block_size - 1, block_size, block_size + 1,
+                     3 * depth * block_size + 5}) {
+            const std::vector<std::uint8_t> data = havaltest::make_data(size);
+            const temp_file file(data);
+            const std::string expected = hasher::hash_file(file.path().c_str());
+
+            const int fd = open(file.path().c_str(), O_RDONLY);
+            check(read_hash(pipeline, fd), expected, name, size, depth);
+
+            // from the current offset of the file
+            if (size > 100) {
+                lseek(fd, 100, SEEK_SET);
+                check(read_hash(pipeline, fd), hasher::hash(&data[100], size - 100), "offset", size, depth);
+            }
+            close(fd);
+        }
+    }
+
+    // pipelines on several threads at once, sharing the pread pool
+    const std::vector<std::uint8_t> data = havaltest::make_data(40 * block_size + 7);
+    const temp_file file(data);
+    const std::string expected = hasher::hash(data.data(), data.size());
+
+    std::vector<std::string> digests(4);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < digests.size(); i++) {
+        threads.emplace_back([&, i] {
+            havalapp::read_pipeline pipeline(backend, 3, block_size);
+            for (int j = 0; j < 8; j++) {
+                const int fd = open(file.path().c_str(), O_RDONLY);
+                digests[i] = read_hash(pipeline, fd);
+                close(fd);
+                if (digests[i] != expected) {
+                    break;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const std::string& digest : digests) {
+        check(digest, expected, "concurrent", data.size(), 3);
+    }
+}
+
+// pipes can not be read at an offset and go through plain reads
+void test_pipe()
+{
+    const std::vector<std::uint8_t> data = havaltest::make_data(10 * block_size + 3);
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        std::cout << "  can not create a pipe" << std::endl;
+        exit_code = 1;
+        return;
+    }
+
+    std::thread writer([&] {
+        for (std::size_t offset = 0; offset < data.size(); offset += 1000) {
+            const std::size_t size = std::min<std::size_t>(1000, data.size() - offset);
+            if (write(fds[1], &data[offset], size) != static_cast<ssize_t>(size)) {
+                break;
+            }
+        }
+        close(fds[1]);
+    });
+
+    havalapp::read_pipeline pipeline(havalapp::io_backend::pread, 4, block_size);
+    check(read_hash(pipeline, fds[0]), hasher::hash(data.data(), data.size()), "pipe", data.size(), 4);
+
+    writer.join();
+    close(fds[0]);
+}
+
+} // namespace
+
+int main()
+{
+    std::cout << "HAVAL read pipelines" << std::endl;
+
+    test_backend(havalapp::io_backend::uring, "io_uring");
+    test_backend(havalapp::io_backend::pread, "pread");
+    test_pipe();
+
+    return exit_code;
+}
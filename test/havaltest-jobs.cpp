@@ -0,0 +1,118 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "havalapp-jobs.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+int exit_code = 0;
+
+// run job_cnt jobs of which the first one is slow, and check that every job is reported once,
+// in index order if asked to, and that at most max_ahead jobs get started past the next one to report
+void test(const char* what, std::size_t job_cnt, unsigned int thread_cnt, bool ordered, std::size_t max_ahead)
+{
+    std::atomic<std::size_t> reported_cnt{0};
+    std::atomic<std::size_t> ahead_max{0};
+
+    std::vector<std::size_t> order;
+    havalapp::run_jobs<std::size_t>(
+            job_cnt, thread_cnt, ordered,
+            [&](std::size_t i) {
+                const std::size_t ahead = i - std::min(i, reported_cnt.load());
+                std::size_t seen = ahead_max.load();
+                while (ahead > seen && !ahead_max.compare_exchange_weak(seen, ahead)) {
+                }
+                if (i == 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                }
+                return i * 3;
+            },
+            [&](std::size_t i, std::size_t&& result) {
+                if (result != i * 3) {
+                    std::cout << "  " << what << ": wrong result for job " << i << std::endl;
+                    exit_code = 1;
+                }
+                order.push_back(i);
+                reported_cnt++;
+                return true;
+            });
+
+    std::vector<std::size_t> sorted = order;
+    std::sort(sorted.begin(), sorted.end());
+    bool all_once = sorted.size() == job_cnt;
+    for (std::size_t i = 0; all_once && i < job_cnt; i++) {
+        all_once = sorted[i] == i;
+    }
+
+    if (!all_once || (ordered && order != sorted)) {
+        std::cout << "  " << what << ": " << order.size() << " of " << job_cnt << " jobs reported, "
+                  << (all_once ? "out of order" : "some missing or repeated") << std::endl;
+        exit_code = 1;
+    }
+
+    if (ahead_max.load() > max_ahead) {
+        std::cout << "  " << what << ": a job started " << ahead_max.load() << " ahead of the next report" << std::endl;
+        exit_code = 1;
+    }
+}
+
+} // namespace
+
+int main()
+{
+    std::cout << "HAVAL program job queue" << std::endl;
+
+    test("single thread", 100, 1, true, 0);
+    test("ordered", 1000, 4, true, 16);
+    test("unordered", 1000, 4, false, 1000);
+    test("more threads than jobs", 3, 8, true, 3);
+
+    // once report returns false nothing else is reported
+    std::size_t reported_cnt = 0;
+    havalapp::run_jobs<int>(
+            1000, 4, true, [](std::size_t) { return 0; },
+            [&](std::size_t i, int&&) {
+                reported_cnt++;
+                return i < 10;
+            });
+    if (reported_cnt != 11) {
+        std::cout << "  " << reported_cnt << " jobs reported after a stop at the 11th" << std::endl;
+        exit_code = 1;
+    }
+
+    return exit_code;
+}
@@ -0,0 +1,112 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "haval-lengths.hpp"
+#include "havaltest-util.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+int exit_code = 0;
+
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void check(const std::string& got, const std::vector<std::uint8_t>& data, const char* what)
+{
+    if (got != haval::haval<pass_cnt, fpt_len>::hash(data.data(), data.size())) {
+        std::cout << "  " << what << " mismatch (PASS=" << pass_cnt << ", FPTLEN=" << fpt_len << ", size "
+                  << data.size() << ")" << std::endl;
+        exit_code = 1;
+    }
+}
+
+template<unsigned int pass_cnt>
+void check_lengths(const std::array<std::string, 5>& got, const std::vector<std::uint8_t>& data, const char* what)
+{
+    check<pass_cnt, 128>(got[0], data, what);
+    check<pass_cnt, 160>(got[1], data, what);
+    check<pass_cnt, 192>(got[2], data, what);
+    check<pass_cnt, 224>(got[3], data, what);
+    check<pass_cnt, 256>(got[4], data, what);
+}
+
+template<unsigned int pass_cnt>
+void test_multi_length(const std::vector<std::uint8_t>& data)
+{
+    check_lengths<pass_cnt>(haval::multi_length<pass_cnt>::hash(data.data(), data.size()), data, "multi_length");
+
+    // streaming in odd pieces
+    haval::multi_length<pass_cnt> context;
+    context.start();
+    for (std::size_t offset = 0; offset < data.size(); offset += 77) {
+        context.update(&data[offset], std::min<std::size_t>(77, data.size() - offset));
+    }
+    check_lengths<pass_cnt>(context.end(), data, "streaming multi_length");
+}
+
+} // namespace
+
+int main()
+{
+    std::cout << "HAVAL at all lengths and pass counts" << std::endl;
+
+    // sizes around the padding boundaries and beyond one all_variants chunk
+    for (std::size_t size : {0u, 1u, 117u, 118u, 128u, 245u, 246u, 1000u, 64u * 1024 + 300}) {
+        const std::vector<std::uint8_t> data = havaltest::make_data(size);
+
+        test_multi_length<3>(data);
+        test_multi_length<4>(data);
+        test_multi_length<5>(data);
+
+        const haval::all_variants::digests_type all = haval::all_variants::hash(data.data(), data.size());
+        check_lengths<3>(all[0], data, "all_variants");
+        check_lengths<4>(all[1], data, "all_variants");
+        check_lengths<5>(all[2], data, "all_variants");
+    }
+
+    std::ifstream f("pi.frac", std::ios::in | std::ios::binary);
+    if (f.good()) {
+        const std::string data_str((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        const std::vector<std::uint8_t> data(data_str.begin(), data_str.end());
+
+        const haval::all_variants::digests_type all = haval::all_variants::hash_file("pi.frac");
+        check_lengths<3>(all[0], data, "all_variants file");
+        check_lengths<4>(all[1], data, "all_variants file");
+        check_lengths<5>(all[2], data, "all_variants file");
+    }
+
+    return exit_code;
+}
@@ -0,0 +1,93 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "havalapp-manifest.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+int exit_code = 0;
+
+const std::string digest = "0123456789abcdef0123456789abcdef";
+
+// write a manifest line for name the way the haval program does and parse it back
+void test(const std::string& name, bool escaped, const std::string& expected_line)
+{
+    std::ostringstream escaped_name;
+    const bool was_escaped = havalapp::write_manifest_name(escaped_name, name);
+    const std::string line = (was_escaped ? "\\" : "") + digest + "  " + escaped_name.str();
+
+    havalapp::manifest_entry entry;
+    if (was_escaped != escaped || line != expected_line || !havalapp::parse_manifest_line(line, digest.size(), entry) ||
+            entry.digest != digest || entry.name != name) {
+        std::cout << "  round trip failed for " << expected_line << std::endl;
+        exit_code = 1;
+    }
+}
+
+void test_malformed(const std::string& line)
+{
+    havalapp::manifest_entry entry;
+    if (havalapp::parse_manifest_line(line, digest.size(), entry)) {
+        std::cout << "  malformed line accepted: " << line << std::endl;
+        exit_code = 1;
+    }
+}
+
+} // namespace
+
+int main()
+{
+    std::cout << "HAVAL manifest lines" << std::endl;
+
+    test("plain name", false, digest + "  plain name");
+    test("back\\slash", true, "\\" + digest + "  back\\\\slash");
+    test("new\nline", true, "\\" + digest + "  new\\nline");
+    test("carriage\rreturn", true, "\\" + digest + "  carriage\\rreturn");
+    test("\r\n\\", true, "\\" + digest + "  \\r\\n\\\\");
+
+    // uppercase digests are accepted and returned in lowercase
+    havalapp::manifest_entry entry;
+    if (!havalapp::parse_manifest_line("0123456789ABCDEF0123456789ABCDEF *name", digest.size(), entry) ||
+            entry.digest != digest || entry.name != "name") {
+        std::cout << "  uppercase digest or binary marker not accepted" << std::endl;
+        exit_code = 1;
+    }
+
+    test_malformed(digest + " name");
+    test_malformed(digest + "  ");
+    test_malformed("0123456789abcdeg0123456789abcdef  name");
+    test_malformed("\\" + digest + "  bad\\escape");
+    test_malformed("\\" + digest + "  trailing\\");
+
+    return exit_code;
+}
@@ -0,0 +1,181 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "haval-multi.hpp"
+#include "havaltest-util.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+int exit_code = 0;
+
+// deterministic pseudo-random test data
+// hash messages of different lengths in one go and compare with the sequential implementation
+template<unsigned int pass_cnt, unsigned int fpt_len, unsigned int lanes, typename word_type>
+void test_one_shot(std::size_t base_len)
+{
+    using hasher = haval::multi_haval<pass_cnt, fpt_len, lanes, word_type>;
+
+    std::vector<std::uint8_t> data[lanes];
+    std::string results[lanes];
+    const void* data_ptrs[lanes];
+    std::size_t data_lens[lanes];
+    void* result_ptrs[lanes];
+
+    for (unsigned int l = 0; l < lanes; l++) {
+        data[l] = havaltest::make_data(base_len + l * 37, l + 1);
+        results[l].resize(hasher::result_size);
+        data_ptrs[l] = data[l].data();
+        data_lens[l] = data[l].size();
+        result_ptrs[l] = &results[l][0];
+    }
+
+    hasher::hash(data_ptrs, data_lens, result_ptrs);
+
+    for (unsigned int l = 0; l < lanes; l++) {
+        if (results[l] != haval::haval<pass_cnt, fpt_len>::hash(data[l].data(), data[l].size())) {
+            std::cout << "multi_haval<" << pass_cnt << ", " << fpt_len << ", " << lanes << "> mismatch in lane " << l
+                      << " (length " << data[l].size() << ")" << std::endl;
+            exit_code = 1;
+        }
+    }
+}
+
+// feed lanes with uneven chunks, leaving some of them idle at times
+template<unsigned int pass_cnt, unsigned int fpt_len, unsigned int lanes, typename word_type>
+void test_streaming()
+{
+    using hasher = haval::multi_haval<pass_cnt, fpt_len, lanes, word_type>;
+
+    const auto data = havaltest::make_data(4096, 42);
+
+    hasher context;
+    context.start();
+
+    std::size_t offsets[lanes] = {};
+    for (unsigned int step = 0; step < 64; step++) {
+        const void* data_ptrs[lanes];
+        std::size_t data_lens[lanes];
+        for (unsigned int l = 0; l < lanes; l++) {
+            std::size_t len = (step * 7 + l * 13) % 5 == 0 ? 0 : (step * 31 + l * 17) % 200;
+            if (offsets[l] + len > data.size()) {
+                len = data.size() - offsets[l];
+            }
+            data_ptrs[l] = data.data() + offsets[l];
+            data_lens[l] = len;
+            offsets[l] += len;
+        }
+        context.update(data_ptrs, data_lens);
+    }
+
+    std::string results[lanes];
+    void* result_ptrs[lanes];
+    for (unsigned int l = 0; l < lanes; l++) {
+        results[l].resize(hasher::result_size);
+        result_ptrs[l] = &results[l][0];
+    }
+
+    context.end_to(result_ptrs);
+
+    for (unsigned int l = 0; l < lanes; l++) {
+        if (results[l] != haval::haval<pass_cnt, fpt_len>::hash(data.data(), offsets[l])) {
+            std::cout << "multi_haval<" << pass_cnt << ", " << fpt_len << ", " << lanes << "> streaming mismatch in lane "
+                      << l << std::endl;
+            exit_code = 1;
+        }
+    }
+}
+
+// hash a batch of messages with mixed lengths, more or fewer than there are lanes
+template<unsigned int pass_cnt, unsigned int fpt_len, unsigned int lanes, typename word_type>
+void test_many(std::size_t count)
+{
+    constexpr std::size_t result_size = fpt_len >> 3;
+
+    std::vector<std::vector<std::uint8_t>> data(count);
+    std::vector<const void*> data_ptrs(count);
+    std::vector<std::size_t> data_lens(count);
+    std::vector<std::uint8_t> results(count * result_size);
+
+    for (std::size_t i = 0; i < count; i++) {
+        data[i] = havaltest::make_data((i * 97) % 600, static_cast<std::uint32_t>(i + 7));
+        data_ptrs[i] = data[i].data();
+        data_lens[i] = data[i].size();
+    }
+
+    haval::hash_many<pass_cnt, fpt_len, lanes, word_type>(data_ptrs.data(), data_lens.data(), count, results.data());
+
+    for (std::size_t i = 0; i < count; i++) {
+        const std::string result(reinterpret_cast<const char*>(&results[i * result_size]), result_size);
+        if (result != haval::haval<pass_cnt, fpt_len>::hash(data[i].data(), data[i].size())) {
+            std::cout << "hash_many<" << pass_cnt << ", " << fpt_len << ", " << lanes << "> mismatch in message " << i
+                      << " of " << count << std::endl;
+            exit_code = 1;
+        }
+    }
+}
+
+template<unsigned int pass_cnt, unsigned int fpt_len, unsigned int lanes, typename word_type>
+void test_lanes()
+{
+    for (std::size_t count : {0u, 1u, lanes - 1, lanes + 1, 3 * lanes + 5}) {
+        test_many<pass_cnt, fpt_len, lanes, word_type>(count);
+    }
+    for (std::size_t base_len : {0, 1, 117, 118, 127, 128, 245, 246, 1000}) {
+        test_one_shot<pass_cnt, fpt_len, lanes, word_type>(base_len);
+    }
+    test_streaming<pass_cnt, fpt_len, lanes, word_type>();
+}
+
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void test()
+{
+    std::cout << "HAVAL multi-lane (PASS=" << pass_cnt << ", FPTLEN=" << fpt_len << ")" << std::endl;
+
+    test_lanes<pass_cnt, fpt_len, 3, haval::detail::portable_word<3>>();
+    test_lanes<pass_cnt, fpt_len, 4, typename haval::detail::native_lane_word<4>::type>();
+    test_lanes<pass_cnt, fpt_len, 8, typename haval::detail::native_lane_word<8>::type>();
+    test_lanes<pass_cnt, fpt_len, 16, typename haval::detail::native_lane_word<16>::type>();
+    test_lanes<pass_cnt, fpt_len, 16, haval::detail::portable_word<4>>();
+}
+
+} // namespace
+
+int main()
+{
+    havaltest::for_each_variant([&](auto variant) {
+        test<decltype(variant)::pass_cnt, decltype(variant)::fpt_len>();
+    });
+
+    return exit_code;
+}
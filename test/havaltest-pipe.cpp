@@ -0,0 +1,129 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "havalapp-pipe.h"
+#include "havaltest-util.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace
+{
+
+int exit_code = 0;
+
+// write data to a pipe in pieces of piece_size bytes on one thread while read_pipelined consumes it
+// on this one, then check that every byte arrived in order and that only the last buffer is short
+void test(const char* what, std::size_t data_size, std::size_t buffer_size, unsigned int buffer_cnt,
+        std::size_t piece_size, std::chrono::milliseconds consume_delay = std::chrono::milliseconds(0))
+{
+    const std::vector<std::uint8_t> data = havaltest::make_data(data_size);
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        std::cout << "  can not create a pipe" << std::endl;
+        exit_code = 1;
+        return;
+    }
+
+    std::thread writer([&] {
+        for (std::size_t offset = 0; offset < data.size(); offset += piece_size) {
+            const std::size_t size = std::min(piece_size, data.size() - offset);
+            if (write(fds[1], &data[offset], size) != static_cast<ssize_t>(size)) {
+                break;
+            }
+        }
+        close(fds[1]);
+    });
+
+    std::vector<std::uint8_t> received;
+    std::vector<std::size_t> sizes;
+    try {
+        havalapp::read_pipelined(fds[0], buffer_size, buffer_cnt, [&](const void* buffer, std::size_t size) {
+            const auto* const bytes = static_cast<const std::uint8_t*>(buffer);
+            received.insert(received.end(), bytes, bytes + size);
+            sizes.push_back(size);
+            std::this_thread::sleep_for(consume_delay);
+        });
+    } catch (const std::system_error& e) {
+        std::cout << "  " << what << ": " << e.what() << std::endl;
+        exit_code = 1;
+    }
+
+    writer.join();
+    close(fds[0]);
+
+    bool sizes_ok = true;
+    for (std::size_t i = 0; i < sizes.size(); i++) {
+        sizes_ok = sizes_ok && sizes[i] > 0 && (sizes[i] == buffer_size || i + 1 == sizes.size());
+    }
+    if (received != data || !sizes_ok) {
+        std::cout << "  " << what << " failed (" << received.size() << " of " << data.size() << " bytes in "
+                  << sizes.size() << " buffers)" << std::endl;
+        exit_code = 1;
+    }
+}
+
+} // namespace
+
+int main()
+{
+    std::cout << "HAVAL standard input pipeline" << std::endl;
+
+    // the reader ends with an empty buffer
+    test("exact multiple", 64 * 1024, 4096, 4, 1000);
+    // the reader ends with a short buffer followed by the end marker
+    test("short last buffer", 64 * 1024 + 123, 4096, 4, 1000);
+    // reader and consumer take turns on a single buffer
+    test("single buffer", 64 * 1024 + 123, 4096, 1, 777);
+    test("single buffer, exact multiple", 16 * 1024, 4096, 1, 4096);
+    // the reader fills the ring and has to sleep until the consumer catches up
+    test("slow consumer", 32 * 1024 + 5, 1024, 3, 5000, std::chrono::milliseconds(2));
+    // the write end is closed before anything is written
+    test("nothing written", 0, 4096, 4, 1);
+
+    // read errors surface on the calling thread
+    try {
+        havalapp::read_pipelined(-1, 4096, 4, [](const void*, std::size_t) {
+            std::cout << "  data from an invalid descriptor" << std::endl;
+            exit_code = 1;
+        });
+        std::cout << "  no error from an invalid descriptor" << std::endl;
+        exit_code = 1;
+    } catch (const std::system_error&) {
+    }
+
+    return exit_code;
+}
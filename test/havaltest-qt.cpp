@@ -28,8 +28,10 @@
 
 #include "haval-qt.hpp"
 
+#include <QBuffer>
 #include <QByteArray>
 #include <QFile>
+#include <QFuture>
 #include <QtGlobal>
 
 #include <iostream>
@@ -68,5 +70,69 @@ int main()
         }
     }
 
+    {
+        const QByteArray expected =
+                QByteArray::fromHex(QByteArrayLiteral("AABF0B45AC4A4E84268F50ABCC3EF3806BCC9860EA6A92425F537C46A957963A"));
+        if (QHaval<5, 256>::hashFile(QStringLiteral("pi.frac")) != expected ||
+            !QHaval<5, 256>::hashFile(QStringLiteral("missing.file")).isEmpty()) {
+            exit_code = 1;
+        }
+
+        // QFile pointers pick the mapping overload, the read loop takes any other device
+        QFile read_file(QStringLiteral("pi.frac"));
+        if (!read_file.open(QFile::ReadOnly) ||
+            QHaval<5, 256>::hash(static_cast<QIODevice*>(&read_file), 100) != expected) {
+            exit_code = 1;
+        }
+
+        QByteArray data(100 * 1000, 'q');
+        QBuffer buffer(&data);
+        if (!buffer.open(QBuffer::ReadOnly) || QHaval<5, 256>::hash(&buffer) != QHaval<5, 256>::hash(data)) {
+            exit_code = 1;
+        }
+
+        // a mapped file is hashed from its current position, like a read one
+        QFile file(QStringLiteral("pi.frac"));
+        if (!file.open(QFile::ReadOnly)) {
+            exit_code = 1;
+        } else {
+            const QByteArray contents = file.readAll();
+            file.seek(100);
+            if (QHaval<5, 256>::hash(&file) != QHaval<5, 256>::hash(contents.mid(100)) || !file.atEnd()) {
+                exit_code = 1;
+            }
+        }
+    }
+
+    {
+        QFuture<QByteArray> file_future = QHaval<5, 256>::hashFileAsync(QStringLiteral("pi.frac"));
+        QFuture<QByteArray> missing_future = QHaval<5, 256>::hashFileAsync(QStringLiteral("missing.file"));
+        if (file_future.result() !=
+                    QByteArray::fromHex(
+                            QByteArrayLiteral("AABF0B45AC4A4E84268F50ABCC3EF3806BCC9860EA6A92425F537C46A957963A")) ||
+            !missing_future.result().isEmpty()) {
+            exit_code = 1;
+        }
+    }
+
+    {
+        QByteArray data(4 * 1024 * 1024, 'x');
+        QBuffer buffer(&data);
+        buffer.open(QBuffer::ReadOnly);
+        QFuture<QByteArray> future = QHaval<3, 160>::hashAsync(&buffer, nullptr, 64 * 1024);
+        if (future.result() != QHaval<3, 160>::hash(data) || future.progressValue() != future.progressMaximum()) {
+            exit_code = 1;
+        }
+
+        // whether or not the job got to run, it has to wind down once canceled
+        buffer.seek(0);
+        future = QHaval<3, 160>::hashAsync(&buffer, nullptr, 64 * 1024);
+        future.cancel();
+        future.waitForFinished();
+        if (!future.isCanceled() || !future.isFinished()) {
+            exit_code = 1;
+        }
+    }
+
     return exit_code;
 }
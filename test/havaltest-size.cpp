@@ -0,0 +1,80 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "havalapp-size.h"
+
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <string>
+
+namespace
+{
+
+int exit_code = 0;
+
+void test(const std::string& text, bool valid, std::size_t expected = 0)
+{
+    std::size_t size = 0;
+    const bool parsed = havalapp::parse_size(text, size);
+    if (parsed != valid || (valid && size != expected)) {
+        std::cout << "  \"" << text << "\" " << (parsed ? "parsed as " + std::to_string(size) : "rejected") << std::endl;
+        exit_code = 1;
+    }
+}
+
+} // namespace
+
+int main()
+{
+    std::cout << "HAVAL size arguments" << std::endl;
+
+    test("0", true, 0);
+    test("123", true, 123);
+    test("4K", true, 4096);
+    test("4k", true, 4096);
+    test("3M", true, 3 * 1024 * 1024);
+    test("1G", true, 1024 * 1024 * 1024);
+
+    const std::size_t max_size = std::numeric_limits<std::size_t>::max();
+    test(std::to_string(max_size), true, max_size);
+    test(std::to_string(max_size >> 10) + "K", true, (max_size >> 10) << 10);
+
+    test("", false);
+    test("K", false);
+    test("-1", false);
+    test("+1", false);
+    test(" 1", false);
+    test("1T", false);
+    test("1KB", false);
+    test("99999999999999999999999", false);
+    test(std::to_string((max_size >> 10) + 1) + "K", false);
+    test(std::to_string((max_size >> 30) + 1) + "G", false);
+
+    return exit_code;
+}
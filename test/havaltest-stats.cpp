@@ -0,0 +1,133 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "haval-dynamic.hpp"
+#include "haval-tree.hpp"
+#include "haval.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace
+{
+
+int exit_code = 0;
+
+void check(std::uint64_t got, std::uint64_t expected, const char* what)
+{
+    if (got != expected) {
+        std::cout << "  " << what << " = " << got << ", expected " << expected << std::endl;
+        exit_code = 1;
+    }
+}
+
+} // namespace
+
+int main()
+{
+    using hasher = haval::haval<3, 256>;
+
+    std::cout << "HAVAL statistics" << std::endl;
+
+    const std::string data(1000, 'x');
+
+    // 1000 bytes in pieces of 100: every piece is staged, except where a block gets completed
+    haval::reset_thread_stats();
+    hasher context;
+    context.start();
+    for (std::size_t offset = 0; offset < data.size(); offset += 100) {
+        context.update(&data[offset], 100);
+    }
+    context.end();
+
+    const haval::stats streaming = haval::thread_stats();
+    // the padding and the tail are staged too, but they are not message bytes
+    check(streaming.bytes, 1000, "streaming bytes");
+    check(streaming.blocks, 8, "streaming blocks");
+    check(streaming.finalizations, 1, "streaming finalizations");
+    check(streaming.staged_bytes, 1000 + 14 + 10, "streaming staged bytes");
+    check(streaming.reads, 0, "streaming reads");
+
+    // one short message takes the single block path
+    haval::reset_thread_stats();
+    hasher::hash(data.data(), 100);
+    const haval::stats short_message = haval::thread_stats();
+    check(short_message.bytes, 100, "short message bytes");
+    check(short_message.blocks, 1, "short message blocks");
+    check(short_message.finalizations, 1, "short message finalizations");
+
+    // a stream of 300000 bytes read 65536 bytes at a time: 4 full reads and a short one
+    haval::reset_thread_stats();
+    std::istringstream stream(std::string(300000, 'y'));
+    hasher::hash(stream, 65536);
+    const haval::stats stream_stats = haval::thread_stats();
+    check(stream_stats.reads, 5, "stream reads");
+    check(stream_stats.short_reads, 1, "stream short reads");
+    // the remainder of the last read, then the padding, then the tail completing the block
+    check(stream_stats.staging_copies, 3, "stream staging copies");
+
+    // counters are per thread
+    std::thread([] {
+        hasher::hash(std::string(5000, 'z'));
+        check(haval::thread_stats().bytes, 5000, "other thread bytes");
+    }).join();
+    check(haval::thread_stats().bytes, stream_stats.bytes, "bytes after other thread");
+
+    // the run-time variant reads streams the same way
+    haval::reset_thread_stats();
+    std::istringstream dynamic_stream(std::string(300000, 'y'));
+    haval::dynamic_haval::hash(3, 256, dynamic_stream, 65536);
+    const haval::stats dynamic_stats = haval::thread_stats();
+    check(dynamic_stats.reads, stream_stats.reads, "dynamic stream reads");
+    check(dynamic_stats.short_reads, stream_stats.short_reads, "dynamic stream short reads");
+    check(dynamic_stats.bytes, stream_stats.bytes, "dynamic stream bytes");
+
+    // leaves hashed on worker threads count for the calling thread, and the tree framing is not message bytes
+    const std::string tree_data(1000003, 't');
+    haval::reset_thread_stats();
+    haval::tree_haval<3, 256>::hash(tree_data.data(), tree_data.size(), 65536, 1);
+    const haval::stats tree_stats = haval::thread_stats();
+    check(tree_stats.bytes, tree_data.size(), "tree bytes");
+    for (unsigned int thread_cnt : {2u, 3u, 4u, 16u}) {
+        haval::reset_thread_stats();
+        haval::tree_haval<3, 256>::hash(tree_data.data(), tree_data.size(), 65536, thread_cnt);
+        const haval::stats parallel_stats = haval::thread_stats();
+        check(parallel_stats.bytes, tree_data.size(), "parallel tree bytes");
+        check(parallel_stats.blocks, tree_stats.blocks, "parallel tree blocks");
+        check(parallel_stats.finalizations, tree_stats.finalizations, "parallel tree finalizations");
+    }
+
+    haval::stats total = streaming;
+    total += short_message;
+    check(total.blocks, streaming.blocks + short_message.blocks, "sum of blocks");
+
+    return exit_code;
+}
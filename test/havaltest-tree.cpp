@@ -0,0 +1,143 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "haval-tree.hpp"
+#include "havaltest-util.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+int exit_code = 0;
+
+// deterministic pseudo-random test data
+std::string le64(std::uint64_t value)
+{
+    std::string result;
+    for (int i = 0; i < 8; i++) {
+        result += static_cast<char>((value >> (i * 8)) & 0xFF);
+    }
+    return result;
+}
+
+// the tree over leaves [first, last), spelled out recursively
+template<typename hasher>
+std::string reference_node(const std::vector<std::string>& leaves, std::size_t first, std::size_t last)
+{
+    if (last - first == 1) {
+        return leaves[first];
+    }
+
+    std::size_t left_cnt = 1;
+    while (left_cnt * 2 < last - first) {
+        left_cnt *= 2;
+    }
+
+    return hasher::hash(
+            std::string(1, '\x01') + reference_node<hasher>(leaves, first, first + left_cnt) +
+            reference_node<hasher>(leaves, first + left_cnt, last));
+}
+
+template<typename hasher>
+std::string reference_tree(const std::string& data, std::size_t leaf_size)
+{
+    std::vector<std::string> leaves;
+    std::size_t offset = 0;
+    do {
+        leaves.push_back(hasher::hash(std::string(1, '\x00') + data.substr(offset, leaf_size)));
+        offset += leaf_size;
+    } while (offset < data.size());
+
+    return hasher::hash(
+            std::string(1, '\x02') + reference_node<hasher>(leaves, 0, leaves.size()) + le64(data.size()) + le64(leaf_size));
+}
+
+template<unsigned int pass_cnt, unsigned int fpt_len>
+void test()
+{
+    using hasher = haval::haval<pass_cnt, fpt_len>;
+    using tree_hasher = haval::tree_haval<pass_cnt, fpt_len>;
+
+    std::cout << "HAVAL-Tree (PASS=" << pass_cnt << ", FPTLEN=" << fpt_len << ")" << std::endl;
+
+    for (std::size_t leaf_size : {1, 128, 1000}) {
+        for (std::size_t data_len : {std::size_t{0}, std::size_t{1}, leaf_size, 2 * leaf_size, 7 * leaf_size + 3,
+                     8 * leaf_size, 13 * leaf_size - 1}) {
+            const std::string data = havaltest::make_string(data_len, static_cast<std::uint32_t>(data_len + leaf_size));
+            const std::string expected = reference_tree<hasher>(data, leaf_size);
+
+            // streaming, in pieces that don't line up with the leaves
+            tree_hasher context(leaf_size);
+            context.start();
+            for (std::size_t offset = 0; offset < data.size(); offset += 77) {
+                context.update(data.data() + offset, std::min<std::size_t>(77, data.size() - offset));
+            }
+            if (context.end() != expected) {
+                std::cout << "  streaming mismatch (leaf size " << leaf_size << ", length " << data_len << ")"
+                          << std::endl;
+                exit_code = 1;
+            }
+
+            for (unsigned int thread_cnt : {1, 2, 3}) {
+                if (tree_hasher::hash(data.data(), data.size(), leaf_size, thread_cnt) != expected) {
+                    std::cout << "  parallel mismatch (leaf size " << leaf_size << ", length " << data_len << ", "
+                              << thread_cnt << " threads)" << std::endl;
+                    exit_code = 1;
+                }
+            }
+        }
+    }
+
+    // a mapped file goes through the parallel implementation
+    std::ifstream f("pi.frac", std::ios::in | std::ios::binary);
+    const std::string pi_frac((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    if (!f.good() && !f.eof()) {
+        std::cout << "pi.frac cannot be opened! Skipping test..." << std::endl;
+    } else if (tree_hasher::hash_file("pi.frac", 64, 2) != reference_tree<hasher>(pi_frac, 64)) {
+        std::cout << "  file mismatch" << std::endl;
+        exit_code = 1;
+    }
+}
+
+} // namespace
+
+int main()
+{
+    havaltest::for_each_variant([&](auto variant) {
+        test<decltype(variant)::pass_cnt, decltype(variant)::fpt_len>();
+    });
+
+    return exit_code;
+}
@@ -0,0 +1,93 @@
+// Copyright (c) 2020, Mike Gelfand
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "havalapp-data.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace havaltest
+{
+
+// the generator havalbench uses for its input
+using havalapp::fill_data;
+
+// pseudo-random bytes, the same for the same size and seed
+inline std::vector<std::uint8_t> make_data(std::size_t size, std::uint32_t seed)
+{
+    std::vector<std::uint8_t> data(size);
+    fill_data(data.data(), size, seed);
+    return data;
+}
+
+// pseudo-random bytes seeded with their size
+inline std::vector<std::uint8_t> make_data(std::size_t size)
+{
+    return make_data(size, static_cast<std::uint32_t>(size));
+}
+
+// pseudo-random bytes as a string
+inline std::string make_string(std::size_t size, std::uint32_t seed)
+{
+    const std::vector<std::uint8_t> data = make_data(size, seed);
+    return std::string(data.begin(), data.end());
+}
+
+// names a HAVAL variant for for_each_variant
+template<unsigned int pass_cnt_value, unsigned int fpt_len_value>
+struct variant {
+    static constexpr unsigned int pass_cnt = pass_cnt_value;
+    static constexpr unsigned int fpt_len = fpt_len_value;
+};
+
+// call test(variant<pass_cnt, fpt_len>()) for all 15 variants
+template<typename test_type>
+void for_each_variant(test_type&& test)
+{
+    test(variant<3, 128>());
+    test(variant<3, 160>());
+    test(variant<3, 192>());
+    test(variant<3, 224>());
+    test(variant<3, 256>());
+    test(variant<4, 128>());
+    test(variant<4, 160>());
+    test(variant<4, 192>());
+    test(variant<4, 224>());
+    test(variant<4, 256>());
+    test(variant<5, 128>());
+    test(variant<5, 160>());
+    test(variant<5, 192>());
+    test(variant<5, 224>());
+    test(variant<5, 256>());
+}
+
+} // namespace havaltest
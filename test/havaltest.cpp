@@ -33,6 +33,13 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace
 {
@@ -79,6 +86,39 @@ void test_string(const char* data, const char* result)
     verify_result(data, hasher::hash(data), result, 0);
 }
 
+#ifndef _WIN32
+
+// hash_fd hashes the rest of a file from wherever it is positioned, and of descriptors that can not be mapped
+template<typename hasher>
+void test_fd(const char* filename, const std::string& data)
+{
+    const int fd = open(filename, O_RDONLY);
+    if (fd < 0 || lseek(fd, 100, SEEK_SET) != 100 || hasher::hash_fd(fd) != hasher::hash(data.substr(100))) {
+        std::cout << filename << " hashed from offset 100 differs" << std::endl;
+        exit_code = 1;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    // small enough to fit into the pipe buffer before it is read
+    int fds[2];
+    if (pipe(fds) != 0) {
+        std::cout << "can not create a pipe" << std::endl;
+        exit_code = 1;
+        return;
+    }
+    const bool written = write(fds[1], data.data(), data.size()) == static_cast<ssize_t>(data.size());
+    close(fds[1]);
+    if (!written || hasher::hash_fd(fds[0]) != hasher::hash(data)) {
+        std::cout << filename << " hashed through a pipe differs" << std::endl;
+        exit_code = 1;
+    }
+    close(fds[0]);
+}
+
+#endif
+
 template<typename hasher>
 void test_file(const char* filename, const char* result)
 {
@@ -87,6 +127,47 @@ void test_file(const char* filename, const char* result)
         std::cout << filename << " cannot be opened! Skipping test..." << std::endl;
     } else {
         verify_result(filename, hasher::hash(f), result, 1);
+        verify_result(filename, hasher::hash_file(filename), result, 1);
+
+        // odd buffer sizes are rounded down to whole blocks
+        f.clear();
+        f.seekg(0);
+        verify_result(filename, hasher::hash(f, 1000), result, 1);
+
+        char buffer[100];
+        f.clear();
+        f.seekg(0);
+        verify_result(filename, hasher::hash(f, buffer, sizeof(buffer)), result, 1);
+
+#ifndef _WIN32
+        f.clear();
+        f.seekg(0);
+        const std::string data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        test_fd<hasher>(filename, data);
+#endif
+    }
+}
+
+// compare one-shot hashing against byte-by-byte streaming around the one- and two-block boundaries
+template<typename hasher>
+void test_lengths()
+{
+    char data[300];
+    for (std::size_t i = 0; i < sizeof(data); ++i) {
+        data[i] = static_cast<char>(i * 37 + 11);
+    }
+
+    hasher context;
+    context.start();
+    for (std::size_t len = 0; len <= sizeof(data); ++len) {
+        hasher copy = context;
+        if (hasher::hash(data, len) != copy.end()) {
+            std::cout << "HAVAL of " << len << " bytes differs from streaming" << std::endl;
+            exit_code = 1;
+        }
+        if (len < sizeof(data)) {
+            context.update(&data[len], 1);
+        }
     }
 }
 
@@ -114,6 +195,8 @@ void test(
 
     test_file<hasher>("pi.frac", result7);
 
+    test_lengths<hasher>();
+
     std::cout << std::endl;
 }
 